@@ -0,0 +1,162 @@
+// Compares the instruction dispatch backends of Chip8::IS on synthetic workloads and optional ROM files.
+//
+// usage: qchip8_dispatch_benchmark [rom files...]
+
+#include "is.h"
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using namespace Chip8;
+
+	constexpr size_t INSTRUCTIONS_PER_RUN = 20'000'000;
+	constexpr size_t BATCH_SIZE = 1000;
+	constexpr size_t REPETITIONS = 5;
+
+	struct Workload
+	{
+		std::string name;
+		std::vector<Byte> rom;
+	};
+
+	struct Machine
+	{
+		Word programCounter = Memory::ROM_START;
+		RegisterSet registerSet;
+		Memory memory;
+		FrameBuffer framebuffer {};
+		KeyBuffer keybuffer {};
+		IS is { programCounter, registerSet, memory, framebuffer, keybuffer };
+
+		explicit Machine(const std::vector<Byte>& rom)
+		{
+			registerSet.reset();
+			memory = rom;
+		}
+	};
+
+	std::vector<Byte> assemble(const std::vector<Word>& opcodes)
+	{
+		std::vector<Byte> rom;
+		for (const auto opcode : opcodes)
+		{
+			rom.push_back(static_cast<Byte>(opcode >> 8));
+			rom.push_back(static_cast<Byte>(opcode & 0xFF));
+		}
+
+		return rom;
+	}
+
+	std::vector<Workload> syntheticWorkloads()
+	{
+		return {
+			{
+				"alu-loop",
+				assemble({
+					0x6001, 0x6102, 0x6203,         // 200: V0..V2 = 1, 2, 3
+					0x8014, 0x8125, 0x8231,         // 206: add, sub, or
+					0x8302, 0x8433, 0x8506,         // 20C: and, xor, shr
+					0x860E, 0x7701, 0x1206          // 212: shl, add immediate, jump 206
+				})
+			},
+			{
+				"mixed-loop",
+				assemble({
+					0xA300, 0x6A00, 0x6B00,         // 200: I = 300, VA = VB = 0
+					0x7A01, 0x3A40, 0x120E,         // 206: VA++, skip if VA == 40, jump 20E
+					0x6A00, 0x8AB4, 0xF01E,         // 20C: VA = 0, VA += VB, I += V0
+					0xA300, 0xF365, 0x4B10,         // 212: I = 300, load V0..V3, skip if VB != 10
+					0x6B00, 0x7B01, 0xD015,         // 218: VB = 0, VB++, draw
+					0x1206                          // 21E: jump 206
+				})
+			}
+		};
+	}
+
+	bool loadWorkload(const std::string& filename, Workload& workload)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		workload.name = filename;
+		workload.rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+		return true;
+	}
+
+	template<typename Runner>
+	double measure(const std::vector<Byte>& rom, Runner runner)
+	{
+		double best = 0.0;
+
+		for (size_t repetition = 0; repetition < REPETITIONS; ++repetition)
+		{
+			Machine machine(rom);
+
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t executed = 0; executed < INSTRUCTIONS_PER_RUN; executed += BATCH_SIZE)
+			{
+				runner(machine);
+			}
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			best = std::max(best, INSTRUCTIONS_PER_RUN / elapsed.count());
+		}
+
+		return best;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	auto workloads = syntheticWorkloads();
+
+	for (int i = 1; i < argc; ++i)
+	{
+		Workload workload;
+		if (!loadWorkload(argv[i], workload))
+		{
+			std::fprintf(stderr, "Could not open %s\n", argv[i]);
+			return 1;
+		}
+
+		workloads.push_back(std::move(workload));
+	}
+
+	std::printf("%-24s %14s %14s %14s %14s %14s\n", "workload", "raw switch", "cached switch", "table", "threaded", "blocks");
+
+	for (const auto& workload : workloads)
+	{
+		// decodes every opcode again, like IS::step() did before the decode cache existed
+		const double raw = measure(workload.rom, [](Machine& machine)
+		{
+			for (size_t i = 0; i < BATCH_SIZE; ++i)
+			{
+				machine.is.step(machine.memory.readWord(machine.programCounter));
+			}
+		});
+
+		const double cachedSwitch = measure(workload.rom, [](Machine& machine) { machine.is.run(BATCH_SIZE, DispatchMode::Switch); });
+		const double table = measure(workload.rom, [](Machine& machine) { machine.is.run(BATCH_SIZE, DispatchMode::Table); });
+		const double threaded = measure(workload.rom, [](Machine& machine) { machine.is.run(BATCH_SIZE, DispatchMode::Threaded); });
+		const double blocks = measure(workload.rom, [](Machine& machine) { machine.is.run(BATCH_SIZE, DispatchMode::Block); });
+
+		std::printf("%-24s %10.1f MIPS %10.1f MIPS %10.1f MIPS %10.1f MIPS %10.1f MIPS\n",
+			workload.name.c_str(), raw / 1e6, cachedSwitch / 1e6, table / 1e6, threaded / 1e6, blocks / 1e6);
+	}
+
+	if (!IS::isThreadedDispatchSupported())
+	{
+		std::printf("\nthreaded dispatch is not supported by this compiler, the column shows the table backend\n");
+	}
+
+	return 0;
+}
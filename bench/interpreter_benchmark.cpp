@@ -0,0 +1,408 @@
+// Measures the interpreter per opcode class and end to end on bundled and optional ROM files.
+// The JSON output is meant to be kept and compared between versions of the dispatch and framebuffer code.
+//
+// usage: qchip8_interpreter_benchmark [--format text|json] [--output FILE] [--dispatch MODE]
+//                                     [--instructions N] [--repetitions N] [rom files...]
+
+#include "machinepool.h"
+#include "tools/commandline.h"
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using namespace Chip8;
+
+	constexpr int FORMAT_VERSION = 1;
+	// small enough that a ROM which reached its final loop is restarted soon
+	constexpr size_t INSTRUCTIONS_PER_FRAME = 1000;
+	constexpr size_t BATCH_SIZE = 1000;
+
+	struct Workload
+	{
+		std::string name;
+		std::vector<Byte> rom;
+	};
+
+	struct Options
+	{
+		std::string format = "text";
+		std::string output;
+		std::string dispatchName = "switch";
+		DispatchMode dispatchMode = DispatchMode::Switch;
+		size_t instructions = 10'000'000;
+		size_t repetitions = 5;
+		std::vector<Workload> roms;
+	};
+
+	struct Result
+	{
+		std::string suite;
+		std::string workload;
+		std::string method;
+		size_t instructions;
+		double seconds;
+	};
+
+	std::vector<Byte> assemble(const std::vector<Word>& opcodes)
+	{
+		std::vector<Byte> rom;
+		for (const auto opcode : opcodes)
+		{
+			rom.push_back(static_cast<Byte>(opcode >> 8));
+			rom.push_back(static_cast<Byte>(opcode & 0xFF));
+		}
+
+		return rom;
+	}
+
+	// loops that spend most of their instructions in one opcode class
+	std::vector<Workload> opcodeWorkloads()
+	{
+		return {
+			{
+				"alu",
+				assemble({
+					0x6001, 0x6102, 0x6203,         // 200: V0..V2 = 1, 2, 3
+					0x8014, 0x8125, 0x8231,         // 206: add, sub, or
+					0x8302, 0x8433, 0x8506,         // 20C: and, xor, shr
+					0x860E, 0x8710, 0x8874,         // 212: shl, move, add
+					0x8987, 0x8A24, 0x8B15,         // 218: subn, add, sub
+					0x1206                          // 21E: jump 206
+				})
+			},
+			{
+				"sprite",
+				assemble({
+					0x6000, 0x6100, 0x620A,         // 200: V0 = V1 = 0, V2 = A
+					0xF229,                         // 206: I = font A
+					0xD015, 0xD10F, 0xD215,         // 208: 5 and 15 rows, wrapping around the edges
+					0xD015, 0x7003, 0x7105,         // 20E: erase, move
+					0x1208                          // 214: jump 208
+				})
+			},
+			{
+				"bulk-move",
+				assemble({
+					0xA300, 0xFF55, 0xA300,         // 200: store V0..VF at 300
+					0xFF65, 0xA310, 0xF755,         // 206: load them back, store V0..V7 at 310
+					0xA310, 0xF765, 0x1200          // 20C: load them back, jump 200
+				})
+			},
+			{
+				"branch",
+				assemble({
+					0x6000, 0x6100,                 // 200: V0 = V1 = 0
+					0x3000, 0x1204,                 // 204: skip if V0 == 0
+					0x4001, 0x1204,                 // 208: skip if V0 != 1
+					0x5010, 0x1204,                 // 20C: skip if V0 == V1
+					0x9010, 0x2220,                 // 210: no skip, call 220
+					0xB218, 0x1204,                 // 214: jump V0 + 218
+					0x1204, 0x0000,                 // 218: jump 204
+					0x0000, 0x0000,
+					0x00EE                          // 220: return
+				})
+			}
+		};
+	}
+
+	// Maze is by David Winter and in the public domain, the counter was written for this benchmark.
+	// Both end in or spin in loops waiting for the frame, like most games do.
+	std::vector<Workload> romWorkloads()
+	{
+		return {
+			{
+				"maze",
+				{
+					0x60, 0x00, 0x61, 0x00, 0xA2, 0x22, 0xC2, 0x01, 0x32, 0x01, 0xA2, 0x1E, 0xD0, 0x14, 0x70, 0x04,
+					0x30, 0x40, 0x12, 0x04, 0x60, 0x00, 0x71, 0x04, 0x31, 0x20, 0x12, 0x04, 0x12, 0x1C, 0x80, 0x40,
+					0x20, 0x10, 0x20, 0x40, 0x80, 0x10
+				}
+			},
+			{
+				"counter",
+				assemble({
+					0x6500, 0xA300, 0xF533,         // 200: V5 = 0, BCD of V5 at 300
+					0xF265, 0x6310, 0x640C,         // 206: digits to V0..V2, position
+					0xF029, 0xD345, 0x7305,         // 20C: draw the hundreds
+					0xF129, 0xD345, 0x7305,         // 212: draw the tens
+					0xF229, 0xD345,                 // 218: draw the ones
+					0x6602, 0xF615,                 // 21C: wait two frames
+					0xF607, 0x3600, 0x1220,         // 220
+					0x00E0, 0x7501, 0x1202          // 226: clear, count, repeat
+				})
+			}
+		};
+	}
+
+	bool loadWorkload(const std::string& filename, Workload& workload)
+	{
+		std::ifstream file(filename, std::ios::binary);
+		if (!file.is_open())
+		{
+			return false;
+		}
+
+		workload.name = filename;
+		workload.rom.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+		return true;
+	}
+
+	std::unique_ptr<Machine> createMachine(const std::vector<Byte>& rom)
+	{
+		auto machine = std::make_unique<Machine>();
+		if (!machine->load(rom))
+		{
+			return nullptr;
+		}
+
+		// CXNN draws the same numbers in every repetition
+		machine->is.setRandomState(1);
+		return machine;
+	}
+
+	// best of the repetitions, runner executes and returns a number of instructions
+	template<typename Runner>
+	double measure(const Options& options, const std::vector<Byte>& rom, Runner runner)
+	{
+		double best = 0.0;
+
+		for (size_t repetition = 0; repetition < options.repetitions; ++repetition)
+		{
+			auto machine = createMachine(rom);
+
+			const auto start = std::chrono::steady_clock::now();
+			for (size_t executed = 0; executed < options.instructions;)
+			{
+				executed += runner(*machine);
+			}
+			const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+
+			best = best == 0.0 ? elapsed.count() : std::min(best, elapsed.count());
+		}
+
+		return best;
+	}
+
+	void runOpcodeSuite(const Options& options, std::vector<Result>& results)
+	{
+		for (const auto& workload : opcodeWorkloads())
+		{
+			// IS::step() decodes every opcode again, run() goes through the decode cache
+			const double step = measure(options, workload.rom, [](Machine& machine)
+			{
+				for (size_t i = 0; i < BATCH_SIZE; ++i)
+				{
+					machine.is.step(machine.memory.readWord(machine.programCounter));
+				}
+
+				return BATCH_SIZE;
+			});
+
+			const auto mode = options.dispatchMode;
+			const double run = measure(options, workload.rom, [mode](Machine& machine)
+			{
+				machine.is.run(BATCH_SIZE, mode);
+				return BATCH_SIZE;
+			});
+
+			results.push_back({ "opcode", workload.name, "step", options.instructions, step });
+			results.push_back({ "opcode", workload.name, options.dispatchName, options.instructions, run });
+		}
+	}
+
+	void runROMSuite(const Options& options, const std::vector<Workload>& workloads, std::vector<Result>& results)
+	{
+		for (const auto& workload : workloads)
+		{
+			const auto mode = options.dispatchMode;
+			const double seconds = measure(options, workload.rom, [mode](Machine& machine)
+			{
+				machine.runFrame(INSTRUCTIONS_PER_FRAME, mode);
+
+				// start over once the program jumps to itself, a finished maze would measure nothing else
+				if (machine.memory.readWord(machine.programCounter) == (0x1000 | machine.programCounter))
+				{
+					machine.programCounter = Memory::ROM_START;
+					machine.framebuffer.fill(0x00);
+				}
+
+				return INSTRUCTIONS_PER_FRAME;
+			});
+
+			results.push_back({ "rom", workload.name, options.dispatchName, options.instructions, seconds });
+		}
+	}
+
+	double instructionsPerSecond(const Result& result)
+	{
+		return result.seconds > 0.0 ? result.instructions / result.seconds : 0.0;
+	}
+
+	void writeJSON(std::ostream& stream, const Options& options, const std::vector<Result>& results)
+	{
+		stream << "{\n"
+			<< "  \"version\": " << FORMAT_VERSION << ",\n"
+			<< "  \"dispatch\": \"" << escapeJSON(options.dispatchName) << "\",\n"
+			<< "  \"threaded_dispatch_supported\": " << (IS::isThreadedDispatchSupported() ? "true" : "false") << ",\n"
+			<< "  \"repetitions\": " << options.repetitions << ",\n"
+			<< "  \"results\": [\n";
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& result = results[i];
+			stream << "    {\"suite\": \"" << escapeJSON(result.suite) << "\""
+				<< ", \"workload\": \"" << escapeJSON(result.workload) << "\""
+				<< ", \"method\": \"" << escapeJSON(result.method) << "\""
+				<< ", \"instructions\": " << result.instructions
+				<< ", \"seconds\": " << result.seconds
+				<< ", \"ips\": " << instructionsPerSecond(result)
+				<< "}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+
+		stream << "  ]\n}\n";
+	}
+
+	void writeText(std::ostream& stream, const std::vector<Result>& results)
+	{
+		stream << std::left << std::setw(8) << "suite" << std::setw(32) << "workload" << std::setw(10) << "method"
+			<< std::right << std::setw(14) << "MIPS" << std::setw(12) << "ns/instr" << "\n";
+
+		for (const auto& result : results)
+		{
+			const auto ips = instructionsPerSecond(result);
+			stream << std::left << std::setw(8) << result.suite << std::setw(32) << result.workload << std::setw(10) << result.method
+				<< std::right << std::fixed << std::setprecision(1) << std::setw(14) << ips / 1e6
+				<< std::setprecision(2) << std::setw(12) << (ips > 0.0 ? 1e9 / ips : 0.0) << "\n";
+		}
+
+		if (!IS::isThreadedDispatchSupported())
+		{
+			stream << "\nthreaded dispatch is not supported by this compiler, the table backend was measured instead\n";
+		}
+	}
+
+	bool parseOptions(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+
+			if (argument.rfind("--", 0) != 0)
+			{
+				Workload workload;
+				if (!loadWorkload(argument, workload))
+				{
+					std::cerr << "could not open " << argument << "\n";
+					return false;
+				}
+
+				options.roms.push_back(std::move(workload));
+				continue;
+			}
+
+			if (i + 1 >= argc)
+			{
+				std::cerr << "missing value for " << argument << "\n";
+				return false;
+			}
+
+			const char* value = argv[++i];
+			bool isValid = true;
+
+			if (argument == "--format")
+			{
+				options.format = value;
+				isValid = options.format == "text" || options.format == "json";
+			}
+			else if (argument == "--output")
+			{
+				options.output = value;
+			}
+			else if (argument == "--dispatch")
+			{
+				options.dispatchName = value;
+				isValid = parseDispatchMode(options.dispatchName, options.dispatchMode);
+			}
+			else if (argument == "--instructions")
+			{
+				isValid = parseSize(value, options.instructions) && options.instructions > 0;
+			}
+			else if (argument == "--repetitions")
+			{
+				isValid = parseSize(value, options.repetitions) && options.repetitions > 0;
+			}
+			else
+			{
+				std::cerr << "unknown option " << argument << "\n";
+				return false;
+			}
+
+			if (!isValid)
+			{
+				std::cerr << "invalid value " << value << " for " << argument << "\n";
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parseOptions(argc, argv, options))
+	{
+		std::cerr << "usage: qchip8_interpreter_benchmark [--format text|json] [--output FILE] [--dispatch switch|table|threaded|block]\n"
+			"                                    [--instructions N] [--repetitions N] [rom files...]\n";
+		return 1;
+	}
+
+	auto roms = romWorkloads();
+	roms.insert(roms.end(), options.roms.begin(), options.roms.end());
+
+	for (const auto& workload : roms)
+	{
+		if (workload.rom.size() > Memory::MAX_ROM_SIZE)
+		{
+			std::cerr << workload.name << " does not fit into memory\n";
+			return 1;
+		}
+	}
+
+	std::vector<Result> results;
+	runOpcodeSuite(options, results);
+	runROMSuite(options, roms, results);
+
+	std::ofstream file;
+	if (!options.output.empty())
+	{
+		file.open(options.output);
+		if (!file.is_open())
+		{
+			std::cerr << "could not write " << options.output << "\n";
+			return 1;
+		}
+	}
+
+	auto& stream = options.output.empty() ? std::cout : file;
+	if (options.format == "json")
+	{
+		writeJSON(stream, options, results);
+	}
+	else
+	{
+		writeText(stream, results);
+	}
+
+	return stream ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+#ifndef BLOCKCACHE_H
+#define BLOCKCACHE_H
+
+#include <assert.h>
+#include <vector>
+#include "datatypes.h"
+#include "instruction.h"
+#include "decodecache.h"
+#include "memory.h"
+
+namespace Chip8
+{
+    // Translates straight-line runs of instructions into cached blocks.
+    // A block is a body of linear instructions followed by one terminator, which is the first
+    // instruction that may branch, draw or write memory (or the instruction after MAX_BLOCK_LENGTH linear ones).
+    // Memory is split into lines with a write generation each, a block is stale as soon as any line it covers was written.
+    class BlockCache : public MemoryObserver
+    {
+    public:
+        constexpr static size_t MAX_BLOCK_LENGTH = 64;
+        constexpr static size_t CODE_CAPACITY = 16384;
+        constexpr static size_t LINE_SIZE = 16;
+
+        struct Block
+        {
+            Word start;
+            Word length;
+            uint32_t codeOffset;
+            uint64_t generation;
+            Instruction terminator;
+        };
+
+        BlockCache(Memory& memory, DecodeCache& decodeCache);
+        ~BlockCache() override;
+
+        BlockCache(const BlockCache&) = delete;
+        BlockCache& operator=(const BlockCache&) = delete;
+
+        // returns the block starting at address, translating it first if it is missing or stale;
+        // like DecodeCache::fetch() the address must leave room for a whole opcode
+        const Block& lookup(Word address);
+
+        inline const Instruction* code(const Block& block) const
+        {
+            return _code.data() + block.codeOffset;
+        }
+
+        void flush();
+        void onMemoryWritten(size_t offset, size_t length) override;
+
+    private:
+        constexpr static uint16_t NO_BLOCK = 0xFFFF;
+
+        Memory& _memory;
+        DecodeCache& _decodeCache;
+
+        StaticArray<uint16_t, Memory::MEMORY_SIZE> _blockIndex;
+        StaticArray<uint64_t, Memory::MEMORY_SIZE / LINE_SIZE> _lineGenerations;
+        std::vector<Block> _blocks;
+        std::vector<Instruction> _code;
+
+        uint64_t _generation(size_t start, size_t end) const;
+        const Block& _translate(Word address);
+    };
+}
+
+#endif // BLOCKCACHE_H
@@ -1,104 +1,231 @@
 #ifndef CPU_H
 #define CPU_H
 
-#include <QObject>
-#include <QAtomicInteger>
-#include <map>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include "cycletable.h"
 #include "datatypes.h"
 #include "memory.h"
+#include "metrics.h"
 #include "registerset.h"
 #include "is.h"
+#include "keymap.h"
+#include "movie.h"
+#include "rewindbuffer.h"
+#include "romcache.h"
+#include "snapshot.h"
+#include "spscqueue.h"
+#include "triplebuffer.h"
 
 namespace Chip8
 {
-    class CPU: public QObject
+    enum class ExecutionMode
     {
-        Q_OBJECT
+        // runs at the target speed, sleeping once per frame
+        Throttled,
+        // runs frames back to back as fast as the host allows
+        Unthrottled
+    };
+
+    struct FrameStatistics
+    {
+        // frames in which the framebuffer changed
+        uint64_t produced;
+        // frames picked up by the consumer through acquireFrame()
+        uint64_t presented;
+        // frames replaced by a newer one before the consumer picked them up
+        uint64_t dropped;
+    };
 
+    class CPU
+    {
     public:
-        CPU(QObject* parent = nullptr);
-        void setROM(QString filename);
-        void loadROM();
+        constexpr static size_t TIMER_FREQUENCY = 60;
+        constexpr static size_t DEFAULT_INSTRUCTIONS_PER_SECOND = 840;
+        constexpr static size_t PRESENTATION_FREQUENCY = 60;
+        constexpr static size_t INPUT_QUEUE_CAPACITY = 256;
+
+        CPU();
+        void setROM(std::string filename);
+        // returns false if the file cannot be read or the ROM does not fit into memory, see ROMCache
+        bool loadROM();
+        // true once a ROM was loaded, before that run(), step() and stepFrame() do nothing
+        bool isLoaded() const;
+
+        // seeds the generator behind CXNN, the seed is kept for every following loadROM(); without one every CPU
+        // picks a random seed. Must not be called while run() is active.
+        void setSeed(uint32_t seed);
+        uint32_t getSeed() const;
 
         void reset();
         void run();
         void stop();
         bool isRunning() const;
+        // true once the program counter left memory or an instruction faulted, the machine then executes nothing
+        // until the next loadROM() or snapshot; frames keep ticking the timers
+        bool isHalted() const;
+        // why the machine halted, Fault::None while it runs
+        Fault getFault() const;
+
+        // executes a single instruction, returns true if the framebuffer was changed
+        bool step();
+        // executes one frame worth of instructions and ticks the timers once
+        bool stepFrame();
+        const FrameBuffer& getFrameBuffer() const;
+        const RegisterSet& getRegisterSet() const;
+        Word getProgramCounter() const;
+        // rows changed since the last call, all rows are dirty after loading a ROM
+        DirtyRows takeDirtyRows();
+
+        void setExecutionMode(ExecutionMode mode);
+        ExecutionMode getExecutionMode() const;
+
+        // number of instructions executed per 60 Hz frame of virtual time
+        void setTargetSpeed(size_t instructionsPerSecond);
+        size_t getTargetSpeed() const;
+
+        void setDispatchMode(DispatchMode mode);
+        DispatchMode getDispatchMode() const;
+
+        // Cycles timing ignores the target speed and the dispatch mode, instructions are dispatched one by one to
+        // charge their cost. The mode may be changed at any time, the table only while run() is not active.
+        void setTimingMode(TimingMode mode);
+        TimingMode getTimingMode() const;
+        void setCycleTable(const CycleTable& table);
+        const CycleTable& getCycleTable() const;
+
+        // achieved speed of run(), updated about once per second
+        double getInstructionsPerSecond() const;
+        FrameStatistics getFrameStatistics() const;
+        // lock-free, may be called from any thread at any time
+        RuntimeMetrics getMetrics() const;
 
-        void keyDown(int key);
-        void keyUp(int key);
+        // Consumer side of the frame handoff of run(), may be called from any single other thread.
+        // run() publishes changed frames at most PRESENTATION_FREQUENCY times per second, acquireFrame() returns
+        // true if a newer frame than the last acquired one is available in getPresentedFrame().
+        bool acquireFrame();
+        const Frame& getPresentedFrame() const;
 
-    signals:
-        void refreshScreen(FrameBuffer framebuffer);
+        // Producer side of the input queue, may be called from any single other thread.
+        // Events are applied by the emulation thread before the next instruction or frame, never in between.
+        // keyDown() and keyUp() take host key codes, queueInput() takes CHIP-8 keys, e.g. from a replay.
+        // All of them return false if the key is not mapped or the queue is full.
+        bool keyDown(int key);
+        bool keyUp(int key);
+        bool queueInput(const InputEvent& event);
+
+        // translates host key codes for keyDown() and keyUp(), must be set from the thread calling those
+        void setKeyMap(const KeyMap& keyMap);
+        const KeyMap& getKeyMap() const;
+
+        // May be called from any thread. While run() is active, the emulation thread takes or restores the snapshot
+        // between two frames and the caller blocks until it is done. A restored snapshot is presented as a new frame.
+        void saveSnapshot(Snapshot& snapshot);
+        void loadSnapshot(const Snapshot& snapshot);
+
+        // Records every frame of run() and stepFrame() so the machine can be stepped backwards, 0 frames turns it off.
+        // Frames after the machine halted are not recorded, rewinding then steps back to before the halt.
+        // Must not be called while run() is active.
+        void setRewindLength(size_t frames, size_t capacity = RewindBuffer::DEFAULT_CAPACITY);
+        // while set, run() steps back one frame per frame at the throttled rate instead of executing, may be called from any thread
+        void setRewinding(bool isRewinding);
+        bool isRewinding() const;
+        // steps back one frame outside of run(), returns false if there is no earlier frame left
+        bool rewindFrame();
+
+        // Movies hold the keys of every frame of run() and stepFrame() from power-on, step() is neither recorded nor replayed.
+        // startRecording() and startReplay() restart the loaded ROM, startReplay() with the seed, speed and timing of the movie,
+        // and end a running recording. Like saveSnapshot() they may be called from any thread. Loading snapshots or rewinding
+        // while recording makes the movie diverge from the session.
+        // startReplay() returns false if no ROM is loaded or the movie was recorded with another one.
+        void startRecording();
+        void stopRecording(Movie& movie);
+        bool startReplay(const Movie& movie);
+        // true until the last frame of the movie has been replayed
+        bool isReplaying() const;
+
+#ifdef QCHIP8_TRACE
+        TraceBuffer& getTrace();
+#endif
+
+#ifdef QCHIP8_PROFILE
+        // counts since the ROM was loaded, not thread-safe against run()
+        Profiler& getProfiler();
+#endif
 
     private:
-        QString _filename;
-        QAtomicInteger<bool> _isRunning;
+        std::string _filename;
+        std::atomic<bool> _isRunning;
         bool _canRefreshScreen;
+        TripleBuffer<Frame> _frames;
+        DirtyRows _unconsumedRows;
+
+        std::atomic<ExecutionMode> _executionMode;
+        std::atomic<DispatchMode> _dispatchMode;
+        std::atomic<TimingMode> _timingMode;
+        CycleTable _cycleTable;
+        // cycles * FRAMES_PER_SECOND left in the current frame, negative after an instruction overran the last one
+        int64_t _cycleBudget;
+        std::atomic<size_t> _targetInstructionsPerSecond;
+        std::atomic<double> _instructionsPerSecond;
+        std::atomic<uint64_t> _producedFrames;
+        std::atomic<uint64_t> _presentedFrames;
+        std::atomic<uint64_t> _droppedFrames;
+        // written by the thread running the emulation, except _droppedInputs which is counted by queueInput()
+        std::atomic<uint64_t> _executedInstructions;
+        std::atomic<uint64_t> _emulatedFrames;
+        std::atomic<double> _framesPerSecond;
+        std::atomic<double> _timerDrift;
+        std::atomic<uint64_t> _timerResyncs;
+        std::atomic<uint64_t> _droppedInputs;
+        LatencyHistogram _inputLatency;
 
         Memory _memory;
         Word _programCounter;
-        Word _opcode;
         RegisterSet _registerSet;
-        IS *_is;
+        std::unique_ptr<IS> _is;
 
         FrameBuffer _framebuffer;
         KeyBuffer _keyStatus;
+        SpscQueue<InputEvent, INPUT_QUEUE_CAPACITY> _inputQueue;
+        KeyMap _keyMap;
 
-        void _decode();
-        void _execute();
-        void _cycle();
+        std::shared_ptr<const ROMImage> _romImage;
+        uint32_t _seed;
+
+        // pending request for the emulation thread, checked once per frame
+        std::mutex _requestMutex;
+        std::condition_variable _requestServiced;
+        std::atomic<bool> _hasRequest;
+        bool _isInsideRun;
+        const std::function<void()>* _request;
 
-        inline const static std::map<int, int> KEY_MAP = {
-            {
-                Qt::Key_1, 0x1
-            },
-            {
-                Qt::Key_2, 0x2
-            },
-            {
-                Qt::Key_3, 0x3
-            },
-            {
-                Qt::Key_4, 0xC
-            },
-            {
-                Qt::Key_Q, 0x4
-            },
-            {
-                Qt::Key_W, 0x5
-            },
-            {
-                Qt::Key_E, 0x6
-            },
-            {
-                Qt::Key_R, 0xD
-            },
-            {
-                Qt::Key_A, 0x7
-            },
-            {
-                Qt::Key_S, 0x8
-            },
-            {
-                Qt::Key_D, 0x9
-            },
-            {
-                Qt::Key_F, 0xE
-            },
-            {
-                Qt::Key_Z, 0xA
-            },
-            {
-                Qt::Key_X, 0x0
-            },
-            {
-                Qt::Key_C, 0xB
-            },
-            {
-                Qt::Key_V, 0xF
-            }
-        };
+        std::unique_ptr<RewindBuffer> _rewindBuffer;
+        Snapshot _rewindSnapshot;
+        std::atomic<bool> _isRewinding;
+
+        bool _isRecording;
+        Movie _recording;
+        Movie _replay;
+        size_t _replayFrame;
+        std::atomic<bool> _isReplaying;
+
+        void _cycle();
+        void _processInput();
+        bool _queueKey(int key, bool isPressed);
+        size_t _runFrame();
+        void _publishFrame();
+        // runs function on the emulation thread between two frames while run() is active, otherwise right away
+        void _synchronize(const std::function<void()>& function);
+        // called with _requestMutex held
+        void _serviceRequest();
+        void _powerOn();
+        void _takeSnapshot(Snapshot& snapshot) const;
+        void _restoreSnapshot(const Snapshot& snapshot);
     };
 }
 
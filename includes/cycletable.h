@@ -0,0 +1,90 @@
+#ifndef CYCLETABLE_H
+#define CYCLETABLE_H
+
+#include "datatypes.h"
+#include "instruction.h"
+
+namespace Chip8
+{
+    enum class TimingMode
+    {
+        // a fixed number of instructions per frame, see CPU::setTargetSpeed()
+        FixedRate,
+        // every frame runs 1/60 s of virtual time by the instruction costs of CPU::setCycleTable()
+        Cycles
+    };
+
+    // Virtual time each operation takes, for running frames by time instead of by a fixed instruction count.
+    // Frames still tick the timers once per 1/60 s, instructions that overrun a frame take the time from the next one.
+    struct CycleTable
+    {
+        constexpr static uint32_t FRAMES_PER_SECOND = 60;
+
+        // clock rate the costs are counted in
+        uint32_t cyclesPerSecond;
+        // indexed by Operation, zero costs are counted as one cycle so a frame always ends
+        StaticArray<uint32_t, OPERATION_COUNT> costs;
+        // DXYN waits for the next vertical blank like on the VIP: the draw takes the rest of the frame instead of its cost
+        bool waitForVBlank;
+    };
+
+    // Approximate duration of the operations in the CHIP-8 interpreter of the COSMAC VIP, in microseconds.
+    // The draw includes the average wait for the display interrupt, skips are counted as not taken.
+    constexpr uint32_t getCOSMACVIPCost(Operation operation)
+    {
+        switch (operation)
+        {
+        case Operation::ClearScreen: return 109;
+        case Operation::Return: return 105;
+        case Operation::Jump: return 105;
+        case Operation::Call: return 105;
+        case Operation::SkipEqualImmediate: return 55;
+        case Operation::SkipNotEqualImmediate: return 55;
+        case Operation::SkipEqualRegister: return 73;
+        case Operation::SkipNotEqualRegister: return 73;
+        case Operation::JumpOffset: return 105;
+        case Operation::Draw: return 22734;
+        case Operation::SkipKeyPressed: return 73;
+        case Operation::SkipKeyNotPressed: return 73;
+        case Operation::WaitKey: return 73;
+        case Operation::StoreBCD: return 927;
+        case Operation::StoreRegisters: return 605;
+        case Operation::LoadImmediate: return 27;
+        case Operation::AddImmediate: return 45;
+        case Operation::Move: return 200;
+        case Operation::Or: return 200;
+        case Operation::And: return 200;
+        case Operation::Xor: return 200;
+        case Operation::Add: return 200;
+        case Operation::Sub: return 200;
+        case Operation::ShiftRight: return 200;
+        case Operation::SubReverse: return 200;
+        case Operation::ShiftLeft: return 200;
+        case Operation::LoadAddress: return 55;
+        case Operation::Random: return 164;
+        case Operation::LoadDelayTimer: return 45;
+        case Operation::SetDelayTimer: return 45;
+        case Operation::SetSoundTimer: return 45;
+        case Operation::AddAddress: return 86;
+        case Operation::LoadFont: return 91;
+        case Operation::LoadRegisters: return 605;
+        default: return 1;
+        }
+    }
+
+    constexpr CycleTable getCOSMACVIPCycleTable(bool waitForVBlank = false)
+    {
+        CycleTable table {};
+        table.cyclesPerSecond = 1'000'000;
+        table.waitForVBlank = waitForVBlank;
+
+        for (size_t i = 0; i < OPERATION_COUNT; ++i)
+        {
+            table.costs[i] = getCOSMACVIPCost(static_cast<Operation>(i));
+        }
+
+        return table;
+    }
+}
+
+#endif // CYCLETABLE_H
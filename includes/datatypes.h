@@ -1,8 +1,9 @@
 #ifndef DATATYPES_H
 #define DATATYPES_H
 
-#include <QMetaType>
 #include <array>
+#include <cstddef>
+#include <cstdint>
 
 namespace Chip8
 {
@@ -28,10 +29,65 @@ namespace Chip8
     constexpr static size_t STACK_SIZE = 16;
     constexpr static size_t KEY_COUNT = 16;
 
-    using FrameBuffer = StaticByteArray<DISPLAY_SIZE>;
+    // one bit per pixel, one 64 bit word per display row, the leftmost pixel is the most significant bit
+    using FrameRow = uint64_t;
+    using FrameBuffer = StaticArray<FrameRow, DISPLAY_HEIGHT>;
+
+    static_assert(sizeof(FrameRow) * 8 == DISPLAY_WIDTH, "a display row must fit into one FrameRow");
+
+    // one bit per display row that changed since the frame was last presented, bit n stands for row n
+    using DirtyRows = uint32_t;
+    constexpr static DirtyRows ALL_ROWS_DIRTY = 0xFFFFFFFF;
+
+    static_assert(sizeof(DirtyRows) * 8 == DISPLAY_HEIGHT, "every display row needs a dirty bit");
+
+    // a framebuffer snapshot handed from the emulation thread to a renderer
+    struct Frame
+    {
+        FrameBuffer framebuffer;
+        // rows changed since the previous frame the consumer picked up
+        DirtyRows dirtyRows;
+        uint64_t number;
+    };
+
+    // a change of one CHIP-8 key, queued by the UI and applied by the emulation thread
+    struct InputEvent
+    {
+        // steady clock time in nanoseconds at which the event was queued
+        uint64_t timestamp;
+        Byte key;
+        bool isPressed;
+    };
+
+    constexpr bool getPixel(const FrameBuffer& framebuffer, size_t x, size_t y)
+    {
+        return ((framebuffer[y] >> (DISPLAY_WIDTH - 1 - x)) & 1) != 0;
+    }
     using KeyBuffer = StaticArray<bool, KEY_COUNT>;
-}
 
-Q_DECLARE_METATYPE(Chip8::FrameBuffer);
+    // pressed keys as a bit mask, bit n stands for key n
+    using KeyMask = uint16_t;
+
+    static_assert(sizeof(KeyMask) * 8 == KEY_COUNT, "every key needs a bit");
+
+    constexpr KeyMask getKeyMask(const KeyBuffer& keys)
+    {
+        KeyMask mask = 0;
+        for (size_t i = 0; i < KEY_COUNT; ++i)
+        {
+            mask |= static_cast<KeyMask>(keys[i] ? 1 << i : 0);
+        }
+
+        return mask;
+    }
+
+    constexpr void setKeyMask(KeyBuffer& keys, KeyMask mask)
+    {
+        for (size_t i = 0; i < KEY_COUNT; ++i)
+        {
+            keys[i] = ((mask >> i) & 1) != 0;
+        }
+    }
+}
 
 #endif // DATATYPES_H
@@ -0,0 +1,44 @@
+#ifndef DECODECACHE_H
+#define DECODECACHE_H
+
+#include <assert.h>
+#include "datatypes.h"
+#include "instruction.h"
+#include "memory.h"
+
+namespace Chip8
+{
+    // Keeps a pre-decoded instruction for every memory address.
+    // Entries are decoded lazily on first fetch and dropped again when memory underneath them is written.
+    class DecodeCache : public MemoryObserver
+    {
+    public:
+        explicit DecodeCache(Memory& memory);
+        ~DecodeCache() override;
+
+        DecodeCache(const DecodeCache&) = delete;
+        DecodeCache& operator=(const DecodeCache&) = delete;
+
+        inline const Instruction& fetch(Word address)
+        {
+            assert(static_cast<size_t>(address) + 1 < Memory::MEMORY_SIZE);
+
+            auto& instruction = _instructions[address];
+            if (instruction.operation == Operation::Undecoded)
+            {
+                instruction = decodeInstruction(_memory.readWord(address));
+            }
+
+            return instruction;
+        }
+
+        void invalidateAll();
+        void onMemoryWritten(size_t offset, size_t length) override;
+
+    private:
+        Memory& _memory;
+        StaticArray<Instruction, Memory::MEMORY_SIZE> _instructions;
+    };
+}
+
+#endif // DECODECACHE_H
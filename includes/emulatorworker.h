@@ -3,7 +3,6 @@
 
 #include <QObject>
 #include "cpu.h"
-#include <QMutex>
 
 class EmulatorWorker : public QObject
 {
@@ -11,24 +10,47 @@ class EmulatorWorker : public QObject
 
 public:
 	explicit EmulatorWorker(QObject* parent = nullptr);
-	void setROM(QString filename);
+	// returns false if the ROM cannot be loaded, the emulation must not be started then
+	bool setROM(QString filename);
+	// queued without locking, the emulation thread applies them between frames
 	void keyDown(int key);
 	void keyUp(int key);
+	void setExecutionMode(Chip8::ExecutionMode mode);
+	// from any thread, the emulation uses the default COSMAC VIP cycle table
+	void setTimingMode(Chip8::TimingMode mode);
+	void setKeyMap(const Chip8::KeyMap& keyMap);
+	// setRewindLength() before the emulation is started, setRewinding() from any thread
+	void setRewindLength(size_t frames);
+	void setRewinding(bool isRewinding);
 
 	bool isRunning() const;
+	double getInstructionsPerSecond() const;
+	Chip8::FrameStatistics getFrameStatistics() const;
+	// lock-free, may be called from any thread
+	Chip8::RuntimeMetrics getMetrics() const;
+
+	// called from the UI thread, see Chip8::CPU::acquireFrame()
+	bool acquireFrame();
+	const Chip8::Frame& getPresentedFrame() const;
+
+	// block until the emulation thread reached the next frame boundary, see Chip8::CPU::saveSnapshot()
+	void saveSnapshot(Chip8::Snapshot& snapshot);
+	void loadSnapshot(const Chip8::Snapshot& snapshot);
+
+	// see Chip8::CPU::startRecording()
+	void startRecording();
+	void stopRecording(Chip8::Movie& movie);
+	bool startReplay(const Chip8::Movie& movie);
 
 public slots:
 	void onRunEmulation();
 	void onStopEmulation();
-	void onRefreshScreen(Chip8::FrameBuffer framebuffer);
 
 signals:
-	void refreshScreen(Chip8::FrameBuffer framebuffer);
 	void finishedEmulation();
 
 private:
 	Chip8::CPU _emulator;
-	QMutex _mutex;
 };
 
 #endif // EMULATORWORKER_H
\ No newline at end of file
@@ -0,0 +1,167 @@
+#ifndef INSTRUCTION_H
+#define INSTRUCTION_H
+
+#include "datatypes.h"
+
+// Operations that may change control flow, the framebuffer or memory, or halt the machine on an access past the end of memory.
+// Their handlers update the program counter themselves.
+#define CHIP8_CONTROL_OPERATIONS(X) \
+    X(Unknown) \
+    X(ClearScreen)              /* 00E0 */ \
+    X(Return)                   /* 00EE */ \
+    X(Jump)                     /* 1NNN */ \
+    X(Call)                     /* 2NNN */ \
+    X(SkipEqualImmediate)       /* 3XNN */ \
+    X(SkipNotEqualImmediate)    /* 4XNN */ \
+    X(SkipEqualRegister)        /* 5XY0 */ \
+    X(SkipNotEqualRegister)     /* 9XY0 */ \
+    X(JumpOffset)               /* BNNN */ \
+    X(Draw)                     /* DXYN */ \
+    X(SkipKeyPressed)           /* EX9E */ \
+    X(SkipKeyNotPressed)        /* EXA1 */ \
+    X(WaitKey)                  /* FX0A */ \
+    X(StoreBCD)                 /* FX33 */ \
+    X(StoreRegisters)           /* FX55 */ \
+    X(LoadRegisters)            /* FX65 */
+
+// Straight-line operations that only touch registers and timers and always advance the program counter by one instruction.
+#define CHIP8_LINEAR_OPERATIONS(X) \
+    X(LoadImmediate)            /* 6XNN */ \
+    X(AddImmediate)             /* 7XNN */ \
+    X(Move)                     /* 8XY0 */ \
+    X(Or)                       /* 8XY1 */ \
+    X(And)                      /* 8XY2 */ \
+    X(Xor)                      /* 8XY3 */ \
+    X(Add)                      /* 8XY4 */ \
+    X(Sub)                      /* 8XY5 */ \
+    X(ShiftRight)               /* 8XY6 */ \
+    X(SubReverse)               /* 8XY7 */ \
+    X(ShiftLeft)                /* 8XYE */ \
+    X(LoadAddress)              /* ANNN */ \
+    X(Random)                   /* CXNN */ \
+    X(LoadDelayTimer)           /* FX07 */ \
+    X(SetDelayTimer)            /* FX15 */ \
+    X(SetSoundTimer)            /* FX18 */ \
+    X(AddAddress)               /* FX1E */ \
+    X(LoadFont)                 /* FX29 */
+
+// All executable operations in handler index order, used to generate the enum and the dispatch tables.
+#define CHIP8_OPERATIONS(X) \
+    CHIP8_CONTROL_OPERATIONS(X) \
+    CHIP8_LINEAR_OPERATIONS(X)
+
+namespace Chip8
+{
+    // Handler index of a decoded instruction. Undecoded marks empty decode cache entries.
+    enum class Operation : Byte
+    {
+        Undecoded = 0,
+#define CHIP8_OPERATION_ENUM(name) name,
+        CHIP8_OPERATIONS(CHIP8_OPERATION_ENUM)
+#undef CHIP8_OPERATION_ENUM
+        Count
+    };
+
+    constexpr static size_t OPERATION_COUNT = static_cast<size_t>(Operation::Count);
+
+    constexpr bool isLinearOperation(Operation operation)
+    {
+        switch (operation)
+        {
+#define CHIP8_LINEAR_CASE(name) case Operation::name:
+        CHIP8_LINEAR_OPERATIONS(CHIP8_LINEAR_CASE)
+#undef CHIP8_LINEAR_CASE
+            return true;
+        default:
+            return false;
+        }
+    }
+
+    // Compact pre-decoded form of an opcode: the handler index plus all operands.
+    struct Instruction
+    {
+        Operation operation;
+        Byte x;
+        Byte y;
+        Byte n;
+        Byte nn;
+        Word nnn;
+    };
+
+    constexpr Operation decodeOperation(Word opcode)
+    {
+        switch (opcode & 0xF000)
+        {
+        case 0x0000:
+            switch (opcode & 0x000F)
+            {
+            case 0x0000: return Operation::ClearScreen;
+            case 0x000E: return Operation::Return;
+            default: return Operation::Unknown;
+            }
+        case 0x1000: return Operation::Jump;
+        case 0x2000: return Operation::Call;
+        case 0x3000: return Operation::SkipEqualImmediate;
+        case 0x4000: return Operation::SkipNotEqualImmediate;
+        case 0x5000: return Operation::SkipEqualRegister;
+        case 0x6000: return Operation::LoadImmediate;
+        case 0x7000: return Operation::AddImmediate;
+        case 0x8000:
+            switch (opcode & 0x000F)
+            {
+            case 0x0000: return Operation::Move;
+            case 0x0001: return Operation::Or;
+            case 0x0002: return Operation::And;
+            case 0x0003: return Operation::Xor;
+            case 0x0004: return Operation::Add;
+            case 0x0005: return Operation::Sub;
+            case 0x0006: return Operation::ShiftRight;
+            case 0x0007: return Operation::SubReverse;
+            case 0x000E: return Operation::ShiftLeft;
+            default: return Operation::Unknown;
+            }
+        case 0x9000: return Operation::SkipNotEqualRegister;
+        case 0xA000: return Operation::LoadAddress;
+        case 0xB000: return Operation::JumpOffset;
+        case 0xC000: return Operation::Random;
+        case 0xD000: return Operation::Draw;
+        case 0xE000:
+            switch (opcode & 0x00FF)
+            {
+            case 0x009E: return Operation::SkipKeyPressed;
+            case 0x00A1: return Operation::SkipKeyNotPressed;
+            default: return Operation::Unknown;
+            }
+        case 0xF000:
+            switch (opcode & 0x00FF)
+            {
+            case 0x0007: return Operation::LoadDelayTimer;
+            case 0x000A: return Operation::WaitKey;
+            case 0x0015: return Operation::SetDelayTimer;
+            case 0x0018: return Operation::SetSoundTimer;
+            case 0x001E: return Operation::AddAddress;
+            case 0x0029: return Operation::LoadFont;
+            case 0x0033: return Operation::StoreBCD;
+            case 0x0055: return Operation::StoreRegisters;
+            case 0x0065: return Operation::LoadRegisters;
+            default: return Operation::Unknown;
+            }
+        default:
+            return Operation::Unknown;
+        }
+    }
+
+    constexpr Instruction decodeInstruction(Word opcode)
+    {
+        return {
+            decodeOperation(opcode),
+            static_cast<Byte>((opcode & 0x0F00) >> 8),
+            static_cast<Byte>((opcode & 0x00F0) >> 4),
+            static_cast<Byte>(opcode & 0x000F),
+            static_cast<Byte>(opcode & 0x00FF),
+            static_cast<Word>(opcode & 0x0FFF)
+        };
+    }
+}
+
+#endif // INSTRUCTION_H
@@ -1,32 +1,163 @@
 #ifndef IS_H
 #define IS_H
 
-#include <QObject>
+#include <memory>
+#include <random>
 #include "datatypes.h"
 #include "registerset.h"
 #include "memory.h"
+#include "instruction.h"
+#include "decodecache.h"
+#include "blockcache.h"
+#include "trace.h"
+#include "profiler.h"
+#include "randomengine.h"
+#include "cycletable.h"
+
+// Threaded dispatch relies on the labels-as-values extension of GCC and Clang.
+#if !defined(QCHIP8_NO_COMPUTED_GOTO) && (defined(__GNUC__) || defined(__clang__))
+#define QCHIP8_COMPUTED_GOTO
+#endif
 
 namespace Chip8
 {
-	class IS : QObject
+	enum class DispatchMode
+	{
+		// one switch over the handler index
+		Switch,
+		// indirect call through a table of handler functions
+		Table,
+		// computed goto from handler to handler, falls back to Table if unsupported
+		Threaded,
+		// translated straight-line blocks, see BlockCache
+		Block
+	};
+
+	// Reason the machine halted, see IS::isHalted().
+	enum class Fault
+	{
+		None,
+		// the program counter left memory, no opcode can be fetched from there
+		ProgramCounter,
+		// DXYN, FX33, FX55 or FX65 would access memory past its end through the address register
+		AddressRegister,
+		// 2NNN with every stack entry in use
+		StackOverflow,
+		// 00EE with an empty stack
+		StackUnderflow
+	};
+
+	class IS
 	{
 	public:
         IS(Word& programCounter,
            RegisterSet& registerSet,
            Memory& memory,
            FrameBuffer& framebuffer,
-           KeyBuffer& keybuffer,
-           QObject* parent = nullptr);
+           KeyBuffer& keybuffer);
 
+		// decodes and executes a raw opcode, bypassing the decode cache
 		bool step(const Word& opcode);
 
+		// returns the pre-decoded instruction at the current program counter
+		inline Instruction fetch()
+		{
+			return _decodeCache.fetch(_programCounter);
+		}
+
+		bool execute(const Instruction& instruction);
+
+		// fetches and executes count instructions, returns true if any of them changed the framebuffer
+		bool run(size_t count, DispatchMode mode = DispatchMode::Switch);
+		// number of instructions the last run() executed, fewer than requested if the machine halted on the way
+		size_t getExecutedCount() const;
+
+		// The machine halts once the program counter leaves memory or an instruction faults, see Fault.
+		// A faulting instruction has no effect and leaves the program counter on itself. run() and runCycles()
+		// then execute nothing until the state is replaced, e.g. by a snapshot, and the fault is cleared.
+		inline bool isHalted() const
+		{
+			return _fault != Fault::None || _programCounter > Memory::MEMORY_SIZE - 2;
+		}
+
+		Fault getFault() const;
+		void clearFault();
+
+		// Executes instructions until their cost used up the budget, which is counted in cycles * FRAMES_PER_SECOND,
+		// so adding cyclesPerSecond grants exactly one frame. An overrun is left in the budget for the next frame,
+		// a halted machine forfeits the budget.
+		// Adds the number of executed instructions to executed and returns true if any of them changed the framebuffer.
+		bool runCycles(const CycleTable& table, int64_t& budget, size_t& executed);
+
+		// returns the rows changed since the last call and clears them
+		DirtyRows takeDirtyRows();
+		// flags rows as changed, e.g. after the framebuffer was replaced from outside
+		void markDirty(DirtyRows rows);
+
+		// state of the generator behind CXNN, seeded from std::random_device unless set
+		uint32_t getRandomState() const;
+		void setRandomState(uint32_t state);
+
+		static bool isThreadedDispatchSupported();
+
+#ifdef QCHIP8_TRACE
+		TraceBuffer& getTrace();
+#endif
+
+#ifdef QCHIP8_PROFILE
+		Profiler& getProfiler();
+#endif
+
 	private:
+		using Handler = bool (IS::*)(const Instruction&);
+		static const Handler HANDLERS[OPERATION_COUNT];
+
 		Word& _programCounter;
 		RegisterSet& _registerSet;
 		Memory& _memory;
         FrameBuffer& _framebuffer;
         KeyBuffer& _keybuffer;
+		DirtyRows _dirtyRows;
+		size_t _executedCount;
+		Fault _fault;
+		DecodeCache _decodeCache;
+		std::unique_ptr<BlockCache> _blockCache;
+		RandomEngine _randomEngine;
+
+#ifdef QCHIP8_TRACE
+		TraceBuffer _trace;
+#endif
+
+#ifdef QCHIP8_PROFILE
+		Profiler _profiler;
+#endif
+
+		bool _runSwitch(size_t count);
+		bool _runTable(size_t count);
+		bool _runThreaded(size_t count);
+		bool _runBlocks(size_t count);
+
+		void _applyLinear(const Instruction& instruction);
+
 		void _stepProgramCounterByte();
+		// returns false and faults if length bytes from the address register on do not fit into memory
+		bool _checkAddressRange(size_t length);
+
+#define CHIP8_DECLARE_CONTROL_HANDLER(name) bool _execute##name(const Instruction& instruction);
+		CHIP8_CONTROL_OPERATIONS(CHIP8_DECLARE_CONTROL_HANDLER)
+#undef CHIP8_DECLARE_CONTROL_HANDLER
+
+		// linear operations only implement their effect, the program counter is advanced by the caller
+#define CHIP8_DECLARE_LINEAR_HANDLER(name) \
+		void _apply##name(const Instruction& instruction); \
+		inline bool _execute##name(const Instruction& instruction) \
+		{ \
+			_apply##name(instruction); \
+			_stepProgramCounterByte(); \
+			return false; \
+		}
+		CHIP8_LINEAR_OPERATIONS(CHIP8_DECLARE_LINEAR_HANDLER)
+#undef CHIP8_DECLARE_LINEAR_HANDLER
 	};
 }
 
@@ -0,0 +1,123 @@
+#ifndef KEYMAP_H
+#define KEYMAP_H
+
+#include <array>
+#include <istream>
+#include <string>
+#include <vector>
+#include "datatypes.h"
+
+namespace Chip8
+{
+    // Maps host key codes to CHIP-8 keys through a flat table, lookups are O(1) and never allocate.
+    // Host key codes follow Qt::Key: Latin-1 characters map to their (uppercase) character code,
+    // special keys such as the arrow keys start at SPECIAL_KEY_BASE. Both ranges get a dense slice of the table.
+    class KeyMap
+    {
+    public:
+        constexpr static Byte NO_KEY = 0xFF;
+        constexpr static int SPECIAL_KEY_BASE = 0x01000000;
+        constexpr static size_t RANGE_SIZE = 256;
+        constexpr static size_t TABLE_SIZE = 2 * RANGE_SIZE;
+
+        constexpr KeyMap() : _table()
+        {
+            clear();
+        }
+
+        constexpr void clear()
+        {
+            for (auto& key : _table)
+            {
+                key = NO_KEY;
+            }
+        }
+
+        // returns false if the host key lies outside of the mappable ranges or the key is no CHIP-8 key
+        constexpr bool map(int hostKey, Byte key)
+        {
+            const auto index = _index(hostKey);
+            if (index >= TABLE_SIZE || (key >= KEY_COUNT && key != NO_KEY))
+            {
+                return false;
+            }
+
+            _table[index] = key;
+            return true;
+        }
+
+        // returns NO_KEY for unmapped host keys
+        constexpr Byte lookup(int hostKey) const
+        {
+            const auto index = _index(hostKey);
+            return index < TABLE_SIZE ? _table[index] : NO_KEY;
+        }
+
+    private:
+        std::array<Byte, TABLE_SIZE> _table;
+
+        constexpr static size_t _index(int hostKey)
+        {
+            if (hostKey >= 0 && hostKey < static_cast<int>(RANGE_SIZE))
+            {
+                return static_cast<size_t>(hostKey);
+            }
+
+            if (hostKey >= SPECIAL_KEY_BASE && hostKey < SPECIAL_KEY_BASE + static_cast<int>(RANGE_SIZE))
+            {
+                return RANGE_SIZE + static_cast<size_t>(hostKey - SPECIAL_KEY_BASE);
+            }
+
+            return TABLE_SIZE;
+        }
+    };
+
+    // the usual layout of the COSMAC VIP hex keypad on the left side of a QWERTY keyboard
+    constexpr KeyMap makeDefaultKeyMap()
+    {
+        constexpr char HOST_KEYS[KEY_COUNT] = {
+            'X', '1', '2', '3',
+            'Q', 'W', 'E', 'A',
+            'S', 'D', 'Z', 'C',
+            '4', 'R', 'F', 'V'
+        };
+
+        KeyMap keyMap;
+        for (size_t key = 0; key < KEY_COUNT; ++key)
+        {
+            keyMap.map(HOST_KEYS[key], static_cast<Byte>(key));
+        }
+
+        return keyMap;
+    }
+
+    constexpr KeyMap DEFAULT_KEY_MAP = makeDefaultKeyMap();
+
+    static_assert(DEFAULT_KEY_MAP.lookup('1') == 0x1 && DEFAULT_KEY_MAP.lookup('V') == 0xF, "the default layout is built at compile time");
+
+    struct KeyProfile
+    {
+        std::string name;
+        KeyMap keyMap;
+    };
+
+    // profiles available without a config file, the first one is the default
+    std::vector<KeyProfile> getBuiltinKeyProfiles();
+
+    // Returns the host key code for a key name from a config file: a single character,
+    // a special key name like "Left" or "Space", or a number. Returns -1 for unknown names.
+    int parseHostKey(const std::string& name);
+
+    // Reads key profiles from an INI-style config file and appends them to profiles:
+    //
+    //   # comment
+    //   [Profile name]
+    //   Up = 5
+    //   Q = 0x4
+    //
+    // Profiles with a name that already exists replace the existing one.
+    // Returns false at the first malformed line, errorLine then holds its 1-based number.
+    bool loadKeyProfiles(std::istream& stream, std::vector<KeyProfile>& profiles, size_t* errorLine = nullptr);
+}
+
+#endif // KEYMAP_H
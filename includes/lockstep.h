@@ -0,0 +1,106 @@
+#ifndef LOCKSTEP_H
+#define LOCKSTEP_H
+
+#include <bitset>
+#include <vector>
+#include "datatypes.h"
+#include "memory.h"
+#include "is.h"
+#include "randomengine.h"
+
+namespace Chip8
+{
+    // Runs many machines with the same ROM side by side, e.g. with different inputs or random seeds.
+    // The registers of all machines (lanes) are stored as structure of arrays, one array per register.
+    // Every step decodes one opcode and applies it to all lanes at the same program counter at once,
+    // arithmetic and comparisons run on SSE2 or AVX2 byte vectors. Lanes whose program counter diverged
+    // are masked out and run in later steps, so results are the same as running every lane on its own IS.
+    // That includes faults: a lane halts where IS would, and stays halted until the next load().
+    class LockstepEngine
+    {
+    public:
+        explicit LockstepEngine(size_t laneCount);
+
+        LockstepEngine(const LockstepEngine&) = delete;
+        LockstepEngine& operator=(const LockstepEngine&) = delete;
+
+        // resets every lane and loads the ROM into it, returns false if the ROM does not fit into memory
+        bool load(const std::vector<Byte>& rom);
+
+        size_t getLaneCount() const;
+
+        void seed(size_t lane, uint32_t seed);
+        void setKey(size_t lane, Byte key, bool isPressed);
+
+        // executes count instructions on every lane, halted lanes execute nothing
+        void run(size_t count);
+        // one 60 Hz tick of the delay and sound timers of every lane
+        void tickTimers();
+        // frames of virtual time, the instruction budget of each frame followed by a timer tick
+        void runFrames(size_t frames, size_t instructionsPerFrame);
+
+        Word getProgramCounter(size_t lane) const;
+        Byte getRegisterValue(size_t lane, size_t index) const;
+        Word getAddressRegister(size_t lane) const;
+        Word getStackPointer(size_t lane) const;
+        Byte getDelayTimer(size_t lane) const;
+        Byte getSoundTimer(size_t lane) const;
+        Byte readByte(size_t lane, size_t offset) const;
+        const FrameBuffer& getFrameBuffer(size_t lane) const;
+        // see IS::getFault()
+        Fault getFault(size_t lane) const;
+
+        // decoded steps and the instructions they executed over all lanes, their ratio is the average lane utilization
+        uint64_t getSteps() const;
+        uint64_t getLaneInstructions() const;
+
+    private:
+        size_t _laneCount;
+        // lane count rounded up to whole vectors, the padding lanes are never active
+        size_t _stride;
+
+        // one row of _stride entries per register, lane n of register r is at r * _stride + n
+        std::vector<Byte> _registers;
+        std::vector<Word> _stack;
+        std::vector<Word> _programCounter;
+        std::vector<Word> _addressRegister;
+        std::vector<Byte> _stackPointer;
+        std::vector<Byte> _delayTimer;
+        std::vector<Byte> _soundTimer;
+        std::vector<uint16_t> _keys;
+
+        // every lane owns a full memory image, lane n starts at n * MEMORY_SIZE
+        std::vector<Byte> _memory;
+        // addresses that may hold different values in different lanes, only there opcodes are compared per lane
+        std::bitset<Memory::MEMORY_SIZE> _divergentMemory;
+
+        std::vector<FrameBuffer> _framebuffers;
+        std::vector<RandomEngine> _randomEngines;
+        std::vector<Fault> _faults;
+
+        // instructions left per lane in the current run(), and the active lanes of the current step (0xFF or 0x00)
+        std::vector<uint32_t> _remaining;
+        std::vector<Byte> _mask;
+        std::vector<Byte> _condition;
+
+        uint64_t _steps;
+        uint64_t _laneInstructions;
+
+        Byte* _register(size_t index);
+        Word _readWord(size_t lane, size_t offset) const;
+        void _writeByte(size_t lane, size_t offset, Byte value);
+
+        bool _selectLanes(Word& programCounter, Word& opcode);
+        // masks out and halts the active lanes on which the instruction would fault
+        void _haltFaultingLanes(const Instruction& instruction);
+        void _execute(Word opcode, Word programCounter);
+
+        void _stepProgramCounters(Word programCounter);
+        void _skipIf(Word programCounter);
+
+        template<typename Function>
+        void _forEachLane(Function function);
+    };
+}
+
+#endif // LOCKSTEP_H
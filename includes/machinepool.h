@@ -0,0 +1,97 @@
+#ifndef MACHINEPOOL_H
+#define MACHINEPOOL_H
+
+#include <memory>
+#include <vector>
+#include "datatypes.h"
+#include "registerset.h"
+#include "memory.h"
+#include "is.h"
+#include "romcache.h"
+#include "snapshot.h"
+#include "threadpool.h"
+
+namespace Chip8
+{
+    // The complete state of one emulated machine without any of the threading and presentation parts of CPU.
+    // Machines are neither copyable nor movable, the instruction set refers to the other members.
+    struct Machine
+    {
+        Word programCounter;
+        RegisterSet registerSet;
+        Memory memory;
+        FrameBuffer framebuffer;
+        KeyBuffer keybuffer;
+        IS is;
+
+        Machine();
+
+        Machine(const Machine&) = delete;
+        Machine& operator=(const Machine&) = delete;
+
+        // returns false if the ROM does not fit into memory, machines loading the same ROM share its image
+        bool load(const std::vector<Byte>& rom);
+        void load(const ROMImage& image);
+
+        // one frame of virtual time: the instruction budget followed by a single timer tick
+        bool runFrame(size_t instructionsPerFrame, DispatchMode mode);
+
+        // restoring one snapshot into several machines forks them from the same state
+        void save(Snapshot& snapshot) const;
+        void restore(const Snapshot& snapshot);
+
+        // takes over the state of source, memory pages stay shared until one of the machines writes to them
+        void fork(const Machine& source);
+    };
+
+    // Hosts many machines in one process and steps them on a fixed set of worker threads.
+    // Machines live in fixed-size arenas that are allocated in one piece and never move, so references stay valid.
+    // The pool itself is not thread-safe, it is meant to be driven from a single controlling thread.
+    class MachinePool
+    {
+    public:
+        using MachineId = size_t;
+
+        constexpr static size_t ARENA_SIZE = 256;
+        // machines a worker runs back to back before the next slice is scheduled
+        constexpr static size_t MACHINES_PER_SLICE = 32;
+        constexpr static size_t DEFAULT_FRAMES_PER_SLICE = 10;
+
+        // 0 uses one worker thread per hardware thread
+        explicit MachinePool(size_t threadCount = 0);
+
+        MachinePool(const MachinePool&) = delete;
+        MachinePool& operator=(const MachinePool&) = delete;
+
+        // adds a machine with the given ROM loaded, returns false if the ROM does not fit into memory
+        bool create(const std::vector<Byte>& rom, MachineId& id);
+        // adds a copy of the machine source, see Machine::fork()
+        MachineId fork(MachineId source);
+
+        size_t size() const;
+        Machine& get(MachineId id);
+        const Machine& get(MachineId id) const;
+
+        void setTargetSpeed(size_t instructionsPerSecond);
+        size_t getTargetSpeed() const;
+
+        void setDispatchMode(DispatchMode mode);
+        DispatchMode getDispatchMode() const;
+
+        // Advances every machine by the given number of frames and blocks until all of them are done.
+        // The work is scheduled in rounds of framesPerSlice frames, each round is split into slices of
+        // MACHINES_PER_SLICE machines, so all machines make progress at the same rate and idle workers steal slices.
+        void runFrames(size_t frames, size_t framesPerSlice = DEFAULT_FRAMES_PER_SLICE);
+
+    private:
+        std::vector<std::unique_ptr<Machine[]>> _arenas;
+        size_t _size;
+        size_t _instructionsPerSecond;
+        DispatchMode _dispatchMode;
+        ThreadPool _threadPool;
+
+        void _runSlice(MachineId first, MachineId last, size_t frames);
+    };
+}
+
+#endif // MACHINEPOOL_H
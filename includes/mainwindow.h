@@ -2,9 +2,18 @@
 #define MAINWINDOW_H
 
 #include <QMainWindow>
+#include <QActionGroup>
 #include <QThread>
+#include <QTimer>
 #include <QMessageBox>
+#include <QPointer>
 #include "emulatorworker.h"
+#include "renderer.h"
+#include "keymap.h"
+#include "metrics.h"
+#include <mutex>
+#include <string>
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 namespace Ui { class MainWindow; }
@@ -15,6 +24,8 @@ class MainWindow : public QMainWindow
 	Q_OBJECT
 
 public:
+	constexpr static int REWIND_KEY = Qt::Key_Backspace;
+
 	MainWindow(QWidget* parent = nullptr);
 	~MainWindow();
 
@@ -27,7 +38,7 @@ private slots:
 
 	void on_action_Load_ROM_triggered();
 
-	void onRefreshScreen(Chip8::FrameBuffer framebuffer);
+	void onPresentFrame();
 
 	void on_action_About_triggered();
 
@@ -37,19 +48,53 @@ private slots:
 
 	void on_actionTake_screenshot_triggered();
 
+	void on_actionUnthrottled_toggled(bool checked);
+
+	void on_actionVIP_timing_toggled(bool checked);
+
+	void on_actionQuick_save_triggered();
+
+	void on_actionQuick_load_triggered();
+
+	void on_actionRecord_movie_toggled(bool checked);
+
+	void on_actionPlay_movie_triggered();
+
+	void onUpdateStatistics();
+
 signals:
 	void stopEmulation();
 
 private:
 	Ui::MainWindow* ui;
 	QThread* _emulatorThread;
-	EmulatorWorker* _emulatorWorker;
+	QPointer<EmulatorWorker> _emulatorWorker;
 	QString _lastFile;
-	QImage _framebuffer;
+	Chip8::Renderer _renderer;
+	QTimer _presentationTimer;
+	QTimer _statisticsTimer;
+	Chip8::FrameStatistics _lastFrameStatistics;
+	std::vector<Chip8::KeyProfile> _keyProfiles;
+	size_t _keyProfile;
+	QActionGroup* _keyProfileActions;
+	// a single in-memory slot, it survives restarting the emulation
+	Chip8::Snapshot _quickSave;
+	// started if QCHIP8_METRICS names an endpoint, scrapes read the worker under the mutex on the server thread
+	Chip8::MetricsServer _metricsServer;
+	std::mutex _metricsMutex;
+	EmulatorWorker* _metricsWorker;
 
 	void _connectSignals() const;
 	void _startEmulation();
+	void _loadKeyProfiles();
+	void _selectKeyProfile(size_t index);
+	// must be cleared before the worker is told to stop, it deletes itself once stopped
+	void _setMetricsWorker(EmulatorWorker* worker);
+	std::string _metricsText();
 
 	bool _isRunning() const;
+	QImage _screenImage() const;
+	Chip8::ExecutionMode _executionMode() const;
+	Chip8::TimingMode _timingMode() const;
 };
 #endif // MAINWINDOW_H
@@ -2,33 +2,120 @@
 #define MEMORY_H
 
 #include "datatypes.h"
-#include <QByteArray>
+#include <atomic>
+#include <vector>
 
 namespace Chip8
 {
+    // Gets notified about every write to a memory range, e.g. to invalidate cached code.
+    class MemoryObserver
+    {
+    public:
+        virtual ~MemoryObserver() = default;
+        virtual void onMemoryWritten(size_t offset, size_t length) = 0;
+    };
+
+    // Memory is split into pages that are shared copy-on-write between copies of a Memory, so forking a machine
+    // copies 16 pointers instead of 4 KB, and a page is only duplicated once one of the sharing machines writes to it.
+    // Pages that were never written to (the font and empty pages) are shared by every Memory in the process.
+    // Observers belong to a single Memory and are not copied.
     class Memory
     {
-    private:
+    public:
         constexpr static size_t MEMORY_SIZE = 4096;
         constexpr static size_t ROM_START = 0x200;
+        constexpr static size_t MAX_ROM_SIZE = MEMORY_SIZE - ROM_START;
+        constexpr static size_t PAGE_SIZE = 256;
+        constexpr static size_t PAGE_COUNT = MEMORY_SIZE / PAGE_SIZE;
+
+        using Page = StaticByteArray<PAGE_SIZE>;
+
+    private:
+        // Counted reference to a page. Unlike std::shared_ptr, whose use_count() is only a relaxed load, every owner
+        // releases the count when it drops the page and isExclusive() acquires it, so a page that turned exclusive
+        // can be written in place after its former owners, which may have copied it on other threads, are done reading.
+        class PageReference
+        {
+        public:
+            // refers to the empty page shared by every Memory in the process
+            PageReference();
+            // a new page no other Memory refers to yet
+            explicit PageReference(const Page& contents);
+            PageReference(const PageReference& other);
+            PageReference& operator=(const PageReference& other);
+            ~PageReference();
+
+            bool isExclusive() const;
+            bool isShared() const;
+
+            // the initial pages, shared by every Memory in the process; they are never exclusive and so never written
+            static const PageReference& getEmptyPage();
+            static const PageReference& getFontPage();
 
-        StaticByteArray<MEMORY_SIZE> _memory;
+            inline const Page& operator*() const
+            {
+                return _block->page;
+            }
 
-        void _loadFontMap();
+            inline Page& operator*()
+            {
+                return _block->page;
+            }
+
+            inline bool operator!=(const PageReference& other) const
+            {
+                return _block != other._block;
+            }
+
+        private:
+            struct Block
+            {
+                std::atomic<size_t> owners;
+                Page page;
+            };
+
+            Block* _block;
+
+            void _release();
+        };
+
+        StaticArray<PageReference, PAGE_COUNT> _pages;
+        std::vector<MemoryObserver*> _observers;
+
+        // copies the page first if it is shared
+        Page& _writablePage(size_t index);
+        void _notifyObservers(size_t offset, size_t length);
     public:
         Memory();
+        // shares all pages with other, observers are not copied
+        Memory(const Memory& other);
+        // shares all pages with other, the own observers are notified about the pages that differ
+        Memory& operator=(const Memory& other);
+
         void resetMemory();
 
+        void addObserver(MemoryObserver* observer);
+        void removeObserver(MemoryObserver* observer);
+
+        // all writes go through writeByte so observers see self-modifying code
         void writeByte(size_t offset, Byte byte);
         Byte readByte(const size_t offset) const;
-        Byte& readByte(const size_t offset);
 
         Word readWord(const size_t offset) const;
 
         Byte operator[](const size_t offset) const;
-        Byte& operator[](const size_t offset);
 
-        Memory& operator=(const QByteArray& data);
+        // copies a ROM to ROM_START, returns false if it does not fit into memory
+        bool load(const Byte* data, size_t size);
+        // same as load(), the ROM must fit into memory
+        Memory& operator=(const std::vector<Byte>& data);
+
+        // copies out the whole memory image, restore() replaces it and notifies the observers about the changed pages
+        void copyTo(StaticByteArray<MEMORY_SIZE>& data) const;
+        void restore(const StaticByteArray<MEMORY_SIZE>& data);
+
+        // pages that are currently shared with another Memory
+        size_t getSharedPageCount() const;
     };
 }
 
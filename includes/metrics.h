@@ -0,0 +1,106 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <atomic>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <thread>
+#include "datatypes.h"
+
+namespace Chip8
+{
+    // Fixed-bucket histogram of durations. record() only does relaxed atomic increments, so one thread can record
+    // while any other thread reads it; a reader may see a count that is one recording ahead of the sum.
+    class LatencyHistogram
+    {
+    public:
+        // upper bounds in nanoseconds, from 250 us doubling up to 128 ms, and an implicit +Inf bucket
+        constexpr static size_t BUCKET_COUNT = 10;
+        constexpr static uint64_t FIRST_BUCKET_BOUND = 250'000;
+
+        LatencyHistogram();
+
+        void record(uint64_t nanoseconds)
+        {
+            size_t bucket = 0;
+            while (bucket < BUCKET_COUNT && nanoseconds > getBucketBound(bucket))
+            {
+                ++bucket;
+            }
+
+            _buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+            _sum.fetch_add(nanoseconds, std::memory_order_relaxed);
+        }
+
+        constexpr static uint64_t getBucketBound(size_t bucket)
+        {
+            return FIRST_BUCKET_BOUND << bucket;
+        }
+
+        // non-cumulative count of one bucket, BUCKET_COUNT is the +Inf bucket
+        uint64_t getBucketCount(size_t bucket) const;
+        uint64_t getCount() const;
+        uint64_t getSum() const;
+
+    private:
+        StaticArray<std::atomic<uint64_t>, BUCKET_COUNT + 1> _buckets;
+        std::atomic<uint64_t> _sum;
+    };
+
+    // Values of the running emulation, read from the lock-free counters of CPU::getMetrics().
+    struct RuntimeMetrics
+    {
+        bool isRunning;
+        uint64_t instructions;
+        double instructionsPerSecond;
+        uint64_t emulatedFrames;
+        double framesPerSecond;
+        uint64_t producedFrames;
+        uint64_t presentedFrames;
+        uint64_t droppedFrames;
+        // wall-clock seconds the 60 Hz timer lost in total, each time a late frame made the frame clock resynchronize
+        double timerDrift;
+        uint64_t timerResyncs;
+        size_t inputQueueDepth;
+        uint64_t droppedInputs;
+        // time from queueing a key event until the emulation thread applied it, per LatencyHistogram bucket
+        StaticArray<uint64_t, LatencyHistogram::BUCKET_COUNT + 1> inputLatencyBuckets;
+        uint64_t inputLatencySum;
+    };
+
+    // Prometheus text exposition format, version 0.0.4
+    void writeMetrics(std::ostream& stream, const RuntimeMetrics& metrics);
+
+    // Serves the text of a provider over HTTP, on a loopback TCP port or a Unix domain socket.
+    // Scrapes run on the server's own thread and only call the provider, which must not block the emulation.
+    class MetricsServer
+    {
+    public:
+        using Provider = std::function<std::string()>;
+
+        MetricsServer();
+        ~MetricsServer();
+
+        MetricsServer(const MetricsServer&) = delete;
+        MetricsServer& operator=(const MetricsServer&) = delete;
+
+        // endpoint is a port ("9180", bound to 127.0.0.1) or "unix:PATH", returns false if it cannot be bound
+        // or sockets are not supported on this platform
+        bool start(const std::string& endpoint, Provider provider);
+        void stop();
+        bool isStarted() const;
+
+    private:
+        int _socket;
+        std::string _socketPath;
+        Provider _provider;
+        std::atomic<bool> _isStarted;
+        std::thread _thread;
+
+        void _serve();
+        void _respond(int connection);
+    };
+}
+
+#endif // METRICS_H
@@ -0,0 +1,43 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "cycletable.h"
+#include "datatypes.h"
+
+namespace Chip8
+{
+    // A recorded session: the pressed keys of every frame from power-on, together with everything else that
+    // decides how the machine runs, so replaying it reproduces the session exactly.
+    struct Movie
+    {
+        // see ROMImage::hash
+        uint64_t romHash = 0;
+        // see IS::setRandomState()
+        uint32_t seed = 1;
+        uint32_t instructionsPerSecond = 0;
+        // see CPU::setTimingMode() and CPU::setCycleTable(), the costs are always those of the COSMAC VIP
+        TimingMode timingMode = TimingMode::FixedRate;
+        bool waitForVBlank = false;
+        uint32_t cyclesPerSecond = 0;
+        std::vector<KeyMask> frames;
+    };
+
+    // Binary movie format, all values are little endian:
+    // "QC8M", version (16 bit), reserved (16 bit), ROM hash (64 bit), seed and instructions per second (32 bit each),
+    // timing mode and wait for vertical blank (8 bit each), cycles per second, frame count and run count (32 bit each),
+    // then the frames as runs of a key mask and the number of frames it was held (16 bit each).
+    constexpr static Word MOVIE_VERSION = 2;
+    // a day at 60 frames per second, longer movies are rejected instead of allocating whatever a file claims
+    constexpr static size_t MAX_MOVIE_FRAMES = 60 * 60 * 60 * 24;
+
+    // returns false if the movie is longer than MAX_MOVIE_FRAMES or the stream fails
+    bool writeMovie(std::ostream& stream, const Movie& movie);
+    // returns false if the stream holds no movie, one with an unsupported version or one that is cut short or
+    // longer than MAX_MOVIE_FRAMES
+    bool readMovie(std::istream& stream, Movie& movie);
+}
+
+#endif // MOVIE_H
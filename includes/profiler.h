@@ -0,0 +1,86 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <ostream>
+#include <vector>
+#include "datatypes.h"
+#include "instruction.h"
+#include "memory.h"
+#include "registerset.h"
+
+// The profiler is compiled in only when QCHIP8_PROFILE is defined (cmake -DQCHIP8_ENABLE_PROFILER=ON).
+// Otherwise CHIP8_PROFILE expands to nothing, like CHIP8_TRACE.
+#ifdef QCHIP8_PROFILE
+#define CHIP8_PROFILE(profiler, programCounter, operation) (profiler).record((programCounter), (operation))
+#else
+#define CHIP8_PROFILE(profiler, programCounter, operation) ((void)0)
+#endif
+
+namespace Chip8
+{
+    // Counts executed instructions per operation, per address and per call path.
+    // Call paths follow the 2NNN/00EE stack of the RegisterSet, so they can be written as folded stacks for flame graphs.
+    class Profiler
+    {
+    public:
+        // distinct call paths that are told apart, calls beyond that are counted to their caller
+        constexpr static size_t MAX_CALL_PATHS = 4096;
+
+        Profiler();
+
+        inline void record(Word programCounter, Operation operation)
+        {
+            const auto address = programCounter & (Memory::MEMORY_SIZE - 1);
+            ++_addressCounts[address];
+            _addressOperations[address] = operation;
+            ++_operationCounts[static_cast<size_t>(operation)];
+            ++_callPaths[_callPath].instructions;
+            ++_instructionsSinceDraw;
+        }
+
+        // called after the stack has changed, the callee of each frame is read from the 2NNN at its call site
+        void updateCallStack(const RegisterSet& registerSet, const Memory& memory);
+        // called after every frame, frames that changed the screen close the current measurement
+        void endFrame(bool hasDrawn);
+
+        void clear();
+
+        uint64_t getInstructionCount() const;
+        uint64_t getOperationCount(Operation operation) const;
+        uint64_t getAddressCount(Word address) const;
+
+        // instructions executed from one frame that changed the screen to the next
+        uint64_t getDrawnFrameCount() const;
+        uint64_t getMinInstructionsPerDraw() const;
+        uint64_t getMaxInstructionsPerDraw() const;
+
+        // summary, operations and the hottest addresses, sorted by count
+        void dumpFlat(std::ostream& stream, size_t addressCount = 20) const;
+        // one "main;sub_2a0;sub_31c count" line per call path, the input format of flamegraph.pl
+        void dumpFolded(std::ostream& stream) const;
+
+    private:
+        struct CallPath
+        {
+            Word callee;
+            size_t parent;
+            uint64_t instructions;
+            std::vector<size_t> children;
+        };
+
+        StaticArray<uint64_t, OPERATION_COUNT> _operationCounts;
+        StaticArray<uint64_t, Memory::MEMORY_SIZE> _addressCounts;
+        StaticArray<Operation, Memory::MEMORY_SIZE> _addressOperations;
+        std::vector<CallPath> _callPaths;
+        size_t _callPath;
+        uint64_t _instructionsSinceDraw;
+        uint64_t _drawnFrames;
+        uint64_t _drawnInstructions;
+        uint64_t _minInstructionsPerDraw;
+        uint64_t _maxInstructionsPerDraw;
+
+        size_t _enterCall(size_t caller, Word callee);
+    };
+}
+
+#endif // PROFILER_H
@@ -0,0 +1,59 @@
+#ifndef RANDOMENGINE_H
+#define RANDOMENGINE_H
+
+#include <cstdint>
+
+namespace Chip8
+{
+    // Park-Miller minimal standard generator, produces the same sequence as std::minstd_rand with the same seed.
+    // Unlike the standard engine its state can be read and restored, so it can be part of snapshots.
+    class RandomEngine
+    {
+    public:
+        using result_type = uint32_t;
+
+        constexpr static result_type MULTIPLIER = 48271;
+        constexpr static result_type MODULUS = 2147483647;
+
+        constexpr explicit RandomEngine(result_type seed = 1) : _state(1)
+        {
+            setState(seed);
+        }
+
+        constexpr static result_type min()
+        {
+            return 1;
+        }
+
+        constexpr static result_type max()
+        {
+            return MODULUS - 1;
+        }
+
+        constexpr result_type operator()()
+        {
+            _state = static_cast<result_type>(static_cast<uint64_t>(_state) * MULTIPLIER % MODULUS);
+            return _state;
+        }
+
+        constexpr result_type getState() const
+        {
+            return _state;
+        }
+
+        // any value is accepted, the same way std::minstd_rand::seed() maps it into the valid range
+        constexpr void setState(result_type state)
+        {
+            _state = state % MODULUS;
+            if (_state == 0)
+            {
+                _state = 1;
+            }
+        }
+
+    private:
+        result_type _state;
+    };
+}
+
+#endif // RANDOMENGINE_H
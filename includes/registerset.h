@@ -17,8 +17,13 @@ namespace Chip8
     public:
         void reset();
 
+        // entry 0 stays unused, so the stack holds STACK_SIZE - 1 return addresses; IS halts before it over- or underflows
         void pushStack(Word value);
         Word popStack();
+        Word getStackPointer() const;
+        const StaticWordArray<STACK_SIZE>& getStack() const;
+        // replaces the whole call stack, e.g. when restoring a snapshot
+        void setStack(const StaticWordArray<STACK_SIZE>& stack, Word stackPointer);
 
         void setRegisterValue(size_t index, Byte value);
         void addRegisterValue(size_t index, Byte value);
@@ -38,6 +43,9 @@ namespace Chip8
         void setSoundTimer(Byte value);
         void decSoundTimer();
         Byte getSoundTimer() const;
+
+        // one 60 Hz tick, counts both timers down towards zero
+        void tickTimers();
     };
 }
 
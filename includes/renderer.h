@@ -0,0 +1,59 @@
+#ifndef RENDERER_H
+#define RENDERER_H
+
+#include <ostream>
+#include <vector>
+#include "datatypes.h"
+
+namespace Chip8
+{
+    // Pixel in 0xAARRGGBB order, matching QImage::Format_RGB32 / Format_ARGB32 on little endian hosts.
+    using Pixel = uint32_t;
+
+    // Software renderer expanding the packed framebuffer into a persistent 32-bit surface.
+    // The surface is an integer nearest-neighbour upscale of the display and is only reallocated when the scale changes.
+    // It does not depend on Qt, so it can be used headlessly for screenshots and video export as well.
+    class Renderer
+    {
+    public:
+        constexpr static size_t DEFAULT_SCALE = 10;
+        constexpr static size_t MAX_SCALE = 64;
+        constexpr static Pixel DEFAULT_FOREGROUND = 0xFFFFFFFF;
+        constexpr static Pixel DEFAULT_BACKGROUND = 0xFF000000;
+
+        explicit Renderer(size_t scale = DEFAULT_SCALE);
+
+        // returns true if the scale changed, the next render() then redraws every row
+        bool setScale(size_t scale);
+        size_t getScale() const;
+
+        // largest integer scale at which the display still fits into the given area
+        static size_t fitScale(size_t width, size_t height);
+
+        void setColors(Pixel foreground, Pixel background);
+
+        // redraws the given rows of the framebuffer into the surface
+        void render(const FrameBuffer& framebuffer, DirtyRows dirtyRows = ALL_ROWS_DIRTY);
+
+        size_t getWidth() const;
+        size_t getHeight() const;
+        // distance between two surface lines in bytes
+        size_t getStride() const;
+        const Pixel* getPixels() const;
+
+        // writes the surface as a binary PPM (P6) image. A video is a sequence of those,
+        // e.g. "ffmpeg -f image2pipe -c:v ppm -framerate 60 -i - out.mp4".
+        void writeImage(std::ostream& stream) const;
+
+    private:
+        size_t _scale;
+        Pixel _foreground;
+        Pixel _background;
+        bool _isInvalidated;
+        std::vector<Pixel> _surface;
+
+        void _renderRow(FrameRow row, size_t y);
+    };
+}
+
+#endif // RENDERER_H
@@ -0,0 +1,67 @@
+#ifndef REWINDBUFFER_H
+#define REWINDBUFFER_H
+
+#include <vector>
+#include "datatypes.h"
+#include "snapshot.h"
+
+namespace Chip8
+{
+    // Records one snapshot per frame so a machine can be stepped backwards.
+    // Only the newest state is kept in full, every older frame is stored as the XOR difference to its successor,
+    // run length encoded, in a byte ring of fixed size. Most of the memory never changes, so a frame usually
+    // takes a few dozen bytes. Once the ring is full the oldest frames are dropped; nothing is allocated after construction.
+    class RewindBuffer
+    {
+    public:
+        constexpr static size_t DEFAULT_FRAMES = 60 * 60;
+        constexpr static size_t DEFAULT_CAPACITY = 1024 * 1024;
+
+        // frames limits how far back the buffer reaches, capacity the bytes used for the differences
+        explicit RewindBuffer(size_t frames = DEFAULT_FRAMES, size_t capacity = DEFAULT_CAPACITY);
+
+        void clear();
+
+        // records the state at the end of a frame
+        void push(const Snapshot& snapshot);
+
+        // drops the newest frame and returns the one before it, false if there is no earlier frame left
+        bool stepBack(Snapshot& snapshot);
+
+        // number of frames stepBack() can go back
+        size_t size() const;
+        size_t getUsedBytes() const;
+        size_t getCapacity() const;
+
+    private:
+        struct Record
+        {
+            size_t offset;
+            size_t size;
+        };
+
+        // ring of encoded differences, the oldest one starts at _begin
+        std::vector<Byte> _data;
+        size_t _begin;
+        size_t _usedBytes;
+
+        std::vector<Record> _records;
+        size_t _firstRecord;
+        size_t _recordCount;
+
+        // the newest state in serialized form, the next one and the encoded difference between them
+        std::vector<Byte> _current;
+        std::vector<Byte> _next;
+        std::vector<Byte> _delta;
+        bool _hasCurrent;
+
+        size_t _encode();
+        void _decode(size_t size);
+
+        void _dropOldest();
+        void _copyIn(const Byte* source, size_t offset, size_t size);
+        void _copyOut(size_t offset, size_t size, Byte* destination) const;
+    };
+}
+
+#endif // REWINDBUFFER_H
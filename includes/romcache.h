@@ -0,0 +1,49 @@
+#ifndef ROMCACHE_H
+#define ROMCACHE_H
+
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "datatypes.h"
+#include "memory.h"
+
+namespace Chip8
+{
+    // A ROM laid out in memory, with the font. It is never written to, so loading it into a machine
+    // (Memory::operator=(const Memory&)) shares its pages instead of copying them.
+    struct ROMImage
+    {
+        uint64_t hash;
+        size_t size;
+        Memory memory;
+    };
+
+    // Process-wide cache of ROM images keyed by a hash of their contents, so machines loading the same ROM
+    // share one image even if it was read from different files. Files are memory-mapped where supported.
+    // All functions are thread-safe.
+    class ROMCache
+    {
+    public:
+        static ROMCache& instance();
+
+        ROMCache(const ROMCache&) = delete;
+        ROMCache& operator=(const ROMCache&) = delete;
+
+        // return false if the file cannot be read or the ROM does not fit into memory
+        bool load(const std::string& filename, std::shared_ptr<const ROMImage>& image);
+        bool load(const Byte* data, size_t size, std::shared_ptr<const ROMImage>& image);
+
+        size_t size() const;
+        // images still in use by callers stay valid
+        void clear();
+
+    private:
+        mutable std::mutex _mutex;
+        std::unordered_map<uint64_t, std::shared_ptr<const ROMImage>> _images;
+
+        ROMCache() = default;
+    };
+}
+
+#endif // ROMCACHE_H
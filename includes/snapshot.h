@@ -0,0 +1,46 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <istream>
+#include <ostream>
+#include <vector>
+#include "datatypes.h"
+#include "memory.h"
+#include "registerset.h"
+
+namespace Chip8
+{
+    // The complete state of a machine. Taking and restoring one is a plain copy of a few kilobytes,
+    // so snapshots can be kept in memory for quick saves or to fork a machine into several others.
+    struct Snapshot
+    {
+        Word programCounter = 0;
+        RegisterSet registerSet {};
+        StaticByteArray<Memory::MEMORY_SIZE> memory {};
+        FrameBuffer framebuffer {};
+        KeyBuffer keys {};
+        // see IS::getRandomState()
+        uint32_t randomState = 1;
+    };
+
+    // Binary snapshot format, all values are little endian:
+    // "QC8S", version (16 bit), reserved (16 bit), PC, I, SP (16 bit each), delay and sound timer, V0 to VF,
+    // the 16 stack entries (16 bit each), the pressed keys as a 16 bit mask, the random state (32 bit), the memory
+    // and the framebuffer rows (64 bit each).
+    constexpr static Word SNAPSHOT_VERSION = 2;
+    constexpr static size_t SNAPSHOT_HEADER_SIZE = 8;
+    constexpr static size_t SNAPSHOT_SIZE = SNAPSHOT_HEADER_SIZE + 3 * sizeof(Word) + 2 + REGISTER_COUNT
+        + STACK_SIZE * sizeof(Word) + sizeof(Word) + sizeof(uint32_t) + Memory::MEMORY_SIZE + DISPLAY_HEIGHT * sizeof(FrameRow);
+
+    // replaces the contents of data with the serialized snapshot
+    void serializeSnapshot(const Snapshot& snapshot, std::vector<Byte>& data);
+    // returns false if data is no snapshot, has an unsupported version or a stack pointer or program counter out of
+    // range, snapshot is left untouched then
+    bool deserializeSnapshot(const Byte* data, size_t size, Snapshot& snapshot);
+    bool deserializeSnapshot(const std::vector<Byte>& data, Snapshot& snapshot);
+
+    bool writeSnapshot(std::ostream& stream, const Snapshot& snapshot);
+    bool readSnapshot(std::istream& stream, Snapshot& snapshot);
+}
+
+#endif // SNAPSHOT_H
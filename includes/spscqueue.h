@@ -0,0 +1,77 @@
+#ifndef SPSCQUEUE_H
+#define SPSCQUEUE_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace Chip8
+{
+    // Lock-free, bounded single producer, single consumer FIFO.
+    // One thread may push() while another one pops, neither side ever blocks or allocates.
+    template<typename T, size_t CAPACITY>
+    class SpscQueue
+    {
+        static_assert(CAPACITY > 0 && (CAPACITY & (CAPACITY - 1)) == 0, "the capacity must be a power of two");
+
+    public:
+        SpscQueue() : _slots(), _head(0), _tail(0)
+        {
+        }
+
+        SpscQueue(const SpscQueue&) = delete;
+        SpscQueue& operator=(const SpscQueue&) = delete;
+
+        // producer side, returns false if the queue is full and the value was not added
+        bool push(const T& value)
+        {
+            const auto tail = _tail.load(std::memory_order_relaxed);
+            if (tail - _head.load(std::memory_order_acquire) == CAPACITY)
+            {
+                return false;
+            }
+
+            _slots[tail & (CAPACITY - 1)] = value;
+            _tail.store(tail + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // consumer side, returns false if the queue is empty
+        bool pop(T& value)
+        {
+            const auto head = _head.load(std::memory_order_relaxed);
+            if (head == _tail.load(std::memory_order_acquire))
+            {
+                return false;
+            }
+
+            value = _slots[head & (CAPACITY - 1)];
+            _head.store(head + 1, std::memory_order_release);
+
+            return true;
+        }
+
+        // consumer side, cheap check for the hot loop
+        bool isEmpty() const
+        {
+            return _head.load(std::memory_order_relaxed) == _tail.load(std::memory_order_acquire);
+        }
+
+        // any thread, the number of queued values at some point during the call
+        size_t size() const
+        {
+            const auto head = _head.load(std::memory_order_acquire);
+            return _tail.load(std::memory_order_acquire) - head;
+        }
+
+    private:
+        std::array<T, CAPACITY> _slots;
+
+        // both indices grow monotonically and live on separate cache lines to avoid false sharing
+        alignas(64) std::atomic<size_t> _head;
+        alignas(64) std::atomic<size_t> _tail;
+    };
+}
+
+#endif // SPSCQUEUE_H
@@ -0,0 +1,61 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Chip8
+{
+    // Fixed set of worker threads with one task deque per worker.
+    // Workers take their own tasks from the back and steal from the front of the other deques once they run dry,
+    // so long running tasks (e.g. slow ROMs) do not leave the remaining threads idle.
+    class ThreadPool
+    {
+    public:
+        using Task = std::function<void()>;
+
+        // 0 uses one thread per hardware thread
+        explicit ThreadPool(size_t threadCount = 0);
+        ~ThreadPool();
+
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        // tasks submitted from outside the pool are distributed round robin, tasks submitted by a worker stay with it
+        void submit(Task task);
+
+        // blocks until every submitted task has finished
+        void wait();
+
+        size_t getThreadCount() const;
+
+    private:
+        struct Worker
+        {
+            std::mutex mutex;
+            std::deque<Task> tasks;
+        };
+
+        std::vector<std::unique_ptr<Worker>> _workers;
+        std::vector<std::thread> _threads;
+
+        std::mutex _mutex;
+        std::condition_variable _taskAvailable;
+        std::condition_variable _tasksFinished;
+        // submitted but not yet finished, and submitted but not yet started
+        size_t _pendingTasks;
+        size_t _queuedTasks;
+        size_t _nextWorker;
+        bool _isStopping;
+
+        void _run(size_t index);
+        bool _popTask(size_t index, Task& task);
+    };
+}
+
+#endif // THREADPOOL_H
@@ -0,0 +1,60 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <ostream>
+#include "datatypes.h"
+
+// Instruction tracing is compiled in only when QCHIP8_TRACE is defined (cmake -DQCHIP8_ENABLE_TRACE=ON).
+// Otherwise CHIP8_TRACE expands to nothing and the hot loop carries no tracing code at all.
+#ifdef QCHIP8_TRACE
+#define CHIP8_TRACE(traceBuffer, programCounter, opcode) (traceBuffer).record((programCounter), (opcode))
+#else
+#define CHIP8_TRACE(traceBuffer, programCounter, opcode) ((void)0)
+#endif
+
+namespace Chip8
+{
+    struct TraceRecord
+    {
+        Word programCounter;
+        Word opcode;
+    };
+
+    // Ring buffer holding the most recent raw (pc, opcode) pairs.
+    // Recording only stores the record, formatting happens later in dump().
+    class TraceBuffer
+    {
+    public:
+        constexpr static size_t TRACE_CAPACITY = 4096;
+
+        TraceBuffer();
+
+        void setEnabled(bool enabled);
+        bool isEnabled() const;
+
+        inline void record(Word programCounter, Word opcode)
+        {
+            if (!_isEnabled)
+            {
+                return;
+            }
+
+            _records[_head % TRACE_CAPACITY] = { programCounter, opcode };
+            ++_head;
+        }
+
+        void clear();
+        size_t size() const;
+        const TraceRecord& at(size_t index) const;
+
+        // writes the recorded instructions, oldest first, not thread-safe against record()
+        void dump(std::ostream& stream) const;
+
+    private:
+        StaticArray<TraceRecord, TRACE_CAPACITY> _records;
+        size_t _head;
+        bool _isEnabled;
+    };
+}
+
+#endif // TRACE_H
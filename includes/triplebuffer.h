@@ -0,0 +1,67 @@
+#ifndef TRIPLEBUFFER_H
+#define TRIPLEBUFFER_H
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+namespace Chip8
+{
+    // Lock-free single producer, single consumer triple buffer.
+    // The producer writes into back() and publishes it, the consumer picks up the most recently published value.
+    // Neither side ever blocks or allocates, values the consumer did not pick up in time are overwritten.
+    template<typename T>
+    class TripleBuffer
+    {
+    public:
+        TripleBuffer() : _buffers(), _middle(1), _back(0), _front(2)
+        {
+        }
+
+        TripleBuffer(const TripleBuffer&) = delete;
+        TripleBuffer& operator=(const TripleBuffer&) = delete;
+
+        // producer side
+        T& back()
+        {
+            return _buffers[_back];
+        }
+
+        // makes back() visible to the consumer, returns true if the previously published value was never consumed
+        bool publish()
+        {
+            const auto previous = _middle.exchange(static_cast<uint8_t>(_back | FRESH_BIT), std::memory_order_acq_rel);
+            _back = previous & INDEX_MASK;
+
+            return (previous & FRESH_BIT) != 0;
+        }
+
+        // consumer side, returns true if front() was replaced with a newer value
+        bool update()
+        {
+            if ((_middle.load(std::memory_order_relaxed) & FRESH_BIT) == 0)
+            {
+                return false;
+            }
+
+            _front = _middle.exchange(_front, std::memory_order_acq_rel) & INDEX_MASK;
+            return true;
+        }
+
+        const T& front() const
+        {
+            return _buffers[_front];
+        }
+
+    private:
+        constexpr static uint8_t INDEX_MASK = 0x3;
+        constexpr static uint8_t FRESH_BIT = 0x4;
+
+        std::array<T, 3> _buffers;
+        std::atomic<uint8_t> _middle;
+        uint8_t _back;
+        uint8_t _front;
+    };
+}
+
+#endif // TRIPLEBUFFER_H
@@ -0,0 +1,111 @@
+#include "blockcache.h"
+#include <algorithm>
+
+namespace Chip8
+{
+	BlockCache::BlockCache(Memory& memory, DecodeCache& decodeCache) : _memory(memory), _decodeCache(decodeCache)
+	{
+		_lineGenerations.fill(0);
+		_blocks.reserve(1024);
+		_code.reserve(CODE_CAPACITY);
+		flush();
+
+		_memory.addObserver(this);
+	}
+
+	BlockCache::~BlockCache()
+	{
+		_memory.removeObserver(this);
+	}
+
+	const BlockCache::Block& BlockCache::lookup(Word address)
+	{
+		assert(static_cast<size_t>(address) + 1 < Memory::MEMORY_SIZE);
+
+		const auto index = _blockIndex[address];
+		if (index != NO_BLOCK)
+		{
+			const auto& block = _blocks[index];
+			const size_t end = block.start + (static_cast<size_t>(block.length) + 1) * 2;
+
+			if (block.generation == _generation(block.start, end))
+			{
+				return block;
+			}
+		}
+
+		return _translate(address);
+	}
+
+	void BlockCache::flush()
+	{
+		_blockIndex.fill(NO_BLOCK);
+		_blocks.clear();
+		_code.clear();
+	}
+
+	void BlockCache::onMemoryWritten(size_t offset, size_t length)
+	{
+		if (length == 0)
+		{
+			return;
+		}
+
+		const size_t last = std::min(offset + length, Memory::MEMORY_SIZE) - 1;
+		for (size_t line = offset / LINE_SIZE; line <= last / LINE_SIZE; ++line)
+		{
+			++_lineGenerations[line];
+		}
+	}
+
+	uint64_t BlockCache::_generation(size_t start, size_t end) const
+	{
+		// generations only ever grow, so their sum changes whenever any covered line was written
+		uint64_t generation = 0;
+		const size_t last = std::min(end, Memory::MEMORY_SIZE) - 1;
+
+		for (size_t line = start / LINE_SIZE; line <= last / LINE_SIZE; ++line)
+		{
+			generation += _lineGenerations[line];
+		}
+
+		return generation;
+	}
+
+	const BlockCache::Block& BlockCache::_translate(Word address)
+	{
+		if (_code.size() + MAX_BLOCK_LENGTH > CODE_CAPACITY || _blocks.size() >= NO_BLOCK)
+		{
+			// stale blocks are never compacted, start over once the code buffer is exhausted
+			flush();
+		}
+
+		Block block {};
+		block.start = address;
+		block.codeOffset = static_cast<uint32_t>(_code.size());
+
+		Instruction instruction = _decodeCache.fetch(address);
+		while (isLinearOperation(instruction.operation) && block.length < MAX_BLOCK_LENGTH)
+		{
+			const size_t next = static_cast<size_t>(address) + 2;
+			if (next + 1 >= Memory::MEMORY_SIZE)
+			{
+				break;
+			}
+
+			_code.push_back(instruction);
+			++block.length;
+
+			address = static_cast<Word>(next);
+			instruction = _decodeCache.fetch(address);
+		}
+
+		block.terminator = instruction;
+		block.generation = _generation(block.start, static_cast<size_t>(address) + 2);
+
+		_blockIndex[block.start] = static_cast<uint16_t>(_blocks.size());
+		_blocks.push_back(block);
+
+		return _blocks.back();
+	}
+}
@@ -1,39 +1,82 @@
 #include "cpu.h"
-#include <QFile>
-#include <QThread>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <thread>
 
 namespace Chip8
 {
-	CPU::CPU(QObject* parent) : QObject(parent), _isRunning(false), _canRefreshScreen(false)
+	CPU::CPU() :
+		_isRunning(false),
+		_canRefreshScreen(false),
+		_unconsumedRows(ALL_ROWS_DIRTY),
+		_executionMode(ExecutionMode::Throttled),
+		_dispatchMode(DispatchMode::Switch),
+		_timingMode(TimingMode::FixedRate),
+		_cycleTable(getCOSMACVIPCycleTable()),
+		_cycleBudget(0),
+		_targetInstructionsPerSecond(DEFAULT_INSTRUCTIONS_PER_SECOND),
+		_instructionsPerSecond(0.0),
+		_producedFrames(0),
+		_presentedFrames(0),
+		_droppedFrames(0),
+		_executedInstructions(0),
+		_emulatedFrames(0),
+		_framesPerSecond(0.0),
+		_timerDrift(0.0),
+		_timerResyncs(0),
+		_droppedInputs(0),
+		_keyMap(DEFAULT_KEY_MAP),
+		_seed(std::random_device{}()),
+		_hasRequest(false),
+		_isInsideRun(false),
+		_request(nullptr),
+		_isRewinding(false),
+		_isRecording(false),
+		_replayFrame(0),
+		_isReplaying(false)
 	{
 	}
 
-	void CPU::setROM(QString filename)
+	void CPU::setROM(std::string filename)
 	{
 		_filename = std::move(filename);
 	}
 
-	void CPU::loadROM()
+	bool CPU::loadROM()
 	{
-		QFile fileDescriptor(_filename);
-		if (!fileDescriptor.open(QIODevice::ReadOnly))
+		if (!ROMCache::instance().load(_filename, _romImage))
 		{
-			return;
+			return false;
 		}
 
-		QByteArray romData = fileDescriptor.readAll();
-		_memory.resetMemory();
-		_memory = romData;
-
 		_isRunning = false;
+		_isRecording = false;
+		_isReplaying = false;
+		_powerOn();
 		_canRefreshScreen = false;
-		_registerSet.reset();
-		_programCounter = { 0x0200 };
-		_opcode = { 0x0000 };
-		_framebuffer.fill({ 0x00 });
-		_keyStatus.fill({ false });
 
-        _is = new IS(_programCounter, _registerSet, _memory, _framebuffer, _keyStatus, this);
+		return true;
+	}
+
+	bool CPU::isLoaded() const
+	{
+		return _is != nullptr;
+	}
+
+	void CPU::setSeed(uint32_t seed)
+	{
+		_seed = seed;
+
+		if (_is)
+		{
+			_is->setRandomState(seed);
+		}
+	}
+
+	uint32_t CPU::getSeed() const
+	{
+		return _seed;
 	}
 
 	void CPU::reset()
@@ -43,22 +86,113 @@ namespace Chip8
 
 	void CPU::run()
 	{
+		if (!_is)
+		{
+			return;
+		}
+
+		using Clock = std::chrono::steady_clock;
+		constexpr auto FRAME_DURATION = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / TIMER_FREQUENCY));
+
+		constexpr auto PRESENTATION_INTERVAL = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / PRESENTATION_FREQUENCY));
+
+		{
+			std::lock_guard<std::mutex> lock(_requestMutex);
+			_isInsideRun = true;
+		}
+
 		_isRunning = true;
 		_canRefreshScreen = true;
 
+		auto nextFrame = Clock::now();
+		auto nextPresentation = nextFrame;
+		auto measureStart = nextFrame;
+		uint64_t measuredInstructions = 0;
+		uint64_t measuredFrames = 0;
+		bool hasPendingFrame = false;
+
 		while (isRunning())
 		{
-			_cycle();
+			if (_hasRequest)
+			{
+				std::lock_guard<std::mutex> lock(_requestMutex);
+				_serviceRequest();
+			}
+
+			const bool isRewinding = _isRewinding;
+			if (isRewinding)
+			{
+				rewindFrame();
+			}
+			else
+			{
+				measuredInstructions += _runFrame();
+				++measuredFrames;
+			}
 
-			// if the draw flag is set, emit an signal to update the parent with the current framebuffer
 			if (_canRefreshScreen)
 			{
 				_canRefreshScreen = false;
-				emit refreshScreen(_framebuffer);
+				++_producedFrames;
+
+				// the pending frame is superseded, only the latest state is ever shown
+				if (hasPendingFrame)
+				{
+					++_droppedFrames;
+				}
+
+				hasPendingFrame = true;
 			}
 
-			QThread::usleep(1200);
+			const auto now = Clock::now();
+
+			// throttled frames are already paced to the display rate, unthrottled ones are coalesced to it before being handed off
+			const bool isPaced = _executionMode == ExecutionMode::Throttled || isRewinding;
+			if (hasPendingFrame && (isPaced || now >= nextPresentation))
+			{
+				hasPendingFrame = false;
+
+				nextPresentation += PRESENTATION_INTERVAL;
+				if (nextPresentation < now)
+				{
+					nextPresentation = now;
+				}
+
+				_publishFrame();
+			}
+
+			const std::chrono::duration<double> measuredTime = now - measureStart;
+			if (measuredTime.count() >= 1.0)
+			{
+				_instructionsPerSecond = measuredInstructions / measuredTime.count();
+				_framesPerSecond = measuredFrames / measuredTime.count();
+				measuredInstructions = 0;
+				measuredFrames = 0;
+				measureStart = now;
+			}
+
+			if (isPaced)
+			{
+				// sleep once per frame; if we fell behind, resynchronize instead of trying to catch up
+				nextFrame += FRAME_DURATION;
+				if (nextFrame < now)
+				{
+					// the timer loses the time it was behind for good
+					const std::chrono::duration<double> drift = now - nextFrame;
+					_timerDrift = _timerDrift + drift.count();
+					++_timerResyncs;
+
+					nextFrame = now;
+				}
+
+				std::this_thread::sleep_until(nextFrame);
+			}
 		}
+
+		// a request posted while the loop was ending must not be left waiting
+		std::lock_guard<std::mutex> lock(_requestMutex);
+		_isInsideRun = false;
+		_serviceRequest();
 	}
 
 	void CPU::stop()
@@ -71,49 +205,545 @@ namespace Chip8
 		return _isRunning;
 	}
 
-	void CPU::keyDown(int key)
+	bool CPU::isHalted() const
 	{
-		if (KEY_MAP.count(key) == 0)
+		return _is && _is->isHalted();
+	}
+
+	Fault CPU::getFault() const
+	{
+		return _is ? _is->getFault() : Fault::None;
+	}
+
+	bool CPU::step()
+	{
+		if (!_is)
 		{
-			return;
+			return false;
 		}
 
-		_keyStatus[KEY_MAP.at(key)] = true;
+		_cycle();
+
+		const bool refresh = _canRefreshScreen;
+		_canRefreshScreen = false;
+
+		return refresh;
 	}
 
-	void CPU::keyUp(int key)
+	bool CPU::stepFrame()
 	{
-		if (KEY_MAP.count(key) == 0)
+		if (!_is)
 		{
+			return false;
+		}
+
+		_runFrame();
+
+		const bool refresh = _canRefreshScreen;
+		_canRefreshScreen = false;
+
+		return refresh;
+	}
+
+	void CPU::setExecutionMode(ExecutionMode mode)
+	{
+		_executionMode = mode;
+	}
+
+	ExecutionMode CPU::getExecutionMode() const
+	{
+		return _executionMode;
+	}
+
+	void CPU::setTargetSpeed(size_t instructionsPerSecond)
+	{
+		_targetInstructionsPerSecond = instructionsPerSecond;
+	}
+
+	size_t CPU::getTargetSpeed() const
+	{
+		return _targetInstructionsPerSecond;
+	}
+
+	void CPU::setDispatchMode(DispatchMode mode)
+	{
+		_dispatchMode = mode;
+	}
+
+	DispatchMode CPU::getDispatchMode() const
+	{
+		return _dispatchMode;
+	}
+
+	void CPU::setTimingMode(TimingMode mode)
+	{
+		_timingMode = mode;
+	}
+
+	TimingMode CPU::getTimingMode() const
+	{
+		return _timingMode;
+	}
+
+	void CPU::setCycleTable(const CycleTable& table)
+	{
+		_cycleTable = table;
+	}
+
+	const CycleTable& CPU::getCycleTable() const
+	{
+		return _cycleTable;
+	}
+
+	double CPU::getInstructionsPerSecond() const
+	{
+		return _instructionsPerSecond;
+	}
+
+	FrameStatistics CPU::getFrameStatistics() const
+	{
+		return { _producedFrames, _presentedFrames, _droppedFrames };
+	}
+
+	RuntimeMetrics CPU::getMetrics() const
+	{
+		RuntimeMetrics metrics;
+		metrics.isRunning = _isRunning;
+		metrics.instructions = _executedInstructions;
+		metrics.instructionsPerSecond = _instructionsPerSecond;
+		metrics.emulatedFrames = _emulatedFrames;
+		metrics.framesPerSecond = _framesPerSecond;
+		metrics.producedFrames = _producedFrames;
+		metrics.presentedFrames = _presentedFrames;
+		metrics.droppedFrames = _droppedFrames;
+		metrics.timerDrift = _timerDrift;
+		metrics.timerResyncs = _timerResyncs;
+		metrics.inputQueueDepth = _inputQueue.size();
+		metrics.droppedInputs = _droppedInputs;
+
+		for (size_t i = 0; i < metrics.inputLatencyBuckets.size(); ++i)
+		{
+			metrics.inputLatencyBuckets[i] = _inputLatency.getBucketCount(i);
+		}
+
+		metrics.inputLatencySum = _inputLatency.getSum();
+
+		return metrics;
+	}
+
+	const FrameBuffer& CPU::getFrameBuffer() const
+	{
+		return _framebuffer;
+	}
+
+	const RegisterSet& CPU::getRegisterSet() const
+	{
+		return _registerSet;
+	}
+
+	Word CPU::getProgramCounter() const
+	{
+		return _programCounter;
+	}
+
+	DirtyRows CPU::takeDirtyRows()
+	{
+		return _is ? _is->takeDirtyRows() : 0;
+	}
+
+	bool CPU::acquireFrame()
+	{
+		if (!_frames.update())
+		{
+			return false;
+		}
+
+		++_presentedFrames;
+		return true;
+	}
+
+	const Frame& CPU::getPresentedFrame() const
+	{
+		return _frames.front();
+	}
+
+	bool CPU::keyDown(int key)
+	{
+		return _queueKey(key, true);
+	}
+
+	bool CPU::keyUp(int key)
+	{
+		return _queueKey(key, false);
+	}
+
+	bool CPU::queueInput(const InputEvent& event)
+	{
+		if (event.key >= KEY_COUNT)
+		{
+			return false;
+		}
+
+		if (!_inputQueue.push(event))
+		{
+			++_droppedInputs;
+			return false;
+		}
+
+		return true;
+	}
+
+	void CPU::setKeyMap(const KeyMap& keyMap)
+	{
+		_keyMap = keyMap;
+	}
+
+	const KeyMap& CPU::getKeyMap() const
+	{
+		return _keyMap;
+	}
+
+	void CPU::saveSnapshot(Snapshot& snapshot)
+	{
+		_synchronize([this, &snapshot]()
+		{
+			_takeSnapshot(snapshot);
+		});
+	}
+
+	void CPU::loadSnapshot(const Snapshot& snapshot)
+	{
+		_synchronize([this, &snapshot]()
+		{
+			_restoreSnapshot(snapshot);
+		});
+	}
+
+	void CPU::setRewindLength(size_t frames, size_t capacity)
+	{
+		if (frames == 0)
+		{
+			_rewindBuffer.reset();
+		}
+		else
+		{
+			_rewindBuffer = std::make_unique<RewindBuffer>(frames, capacity);
+		}
+	}
+
+	void CPU::setRewinding(bool isRewinding)
+	{
+		_isRewinding = isRewinding;
+	}
+
+	bool CPU::isRewinding() const
+	{
+		return _isRewinding;
+	}
+
+	bool CPU::rewindFrame()
+	{
+		if (!_rewindBuffer || !_rewindBuffer->stepBack(_rewindSnapshot))
+		{
+			return false;
+		}
+
+		_restoreSnapshot(_rewindSnapshot);
+		return true;
+	}
+
+	void CPU::startRecording()
+	{
+		_synchronize([this]()
+		{
+			if (!_romImage)
+			{
+				return;
+			}
+
+			_isReplaying = false;
+			_powerOn();
+
+			_recording = {};
+			_recording.romHash = _romImage->hash;
+			_recording.seed = _seed;
+			_recording.instructionsPerSecond = static_cast<uint32_t>(_targetInstructionsPerSecond);
+			_recording.timingMode = _timingMode;
+			_recording.waitForVBlank = _cycleTable.waitForVBlank;
+			_recording.cyclesPerSecond = _cycleTable.cyclesPerSecond;
+			_isRecording = true;
+		});
+	}
+
+	void CPU::stopRecording(Movie& movie)
+	{
+		_synchronize([this, &movie]()
+		{
+			_isRecording = false;
+			movie = std::move(_recording);
+			_recording = {};
+		});
+	}
+
+	bool CPU::startReplay(const Movie& movie)
+	{
+		bool isStarted = false;
+		_synchronize([this, &movie, &isStarted]()
+		{
+			if (!_romImage || _romImage->hash != movie.romHash)
+			{
+				return;
+			}
+
+			_isRecording = false;
+			_replay = movie;
+			_replayFrame = 0;
+			_seed = movie.seed;
+
+			if (movie.instructionsPerSecond > 0)
+			{
+				_targetInstructionsPerSecond = movie.instructionsPerSecond;
+			}
+
+			_timingMode = movie.timingMode;
+			_cycleTable.waitForVBlank = movie.waitForVBlank;
+			if (movie.cyclesPerSecond > 0)
+			{
+				_cycleTable.cyclesPerSecond = movie.cyclesPerSecond;
+			}
+
+			_powerOn();
+			_isReplaying = !_replay.frames.empty();
+			isStarted = true;
+		});
+
+		return isStarted;
+	}
+
+	bool CPU::isReplaying() const
+	{
+		return _isReplaying;
+	}
+
+#ifdef QCHIP8_TRACE
+	TraceBuffer& CPU::getTrace()
+	{
+		return _is->getTrace();
+	}
+#endif
+
+#ifdef QCHIP8_PROFILE
+	Profiler& CPU::getProfiler()
+	{
+		return _is->getProfiler();
+	}
+#endif
+
+	void CPU::_publishFrame()
+	{
+		auto& frame = _frames.back();
+		const DirtyRows changedRows = _is->takeDirtyRows();
+		const DirtyRows dirtyRows = changedRows | _unconsumedRows;
+
+		frame.framebuffer = _framebuffer;
+		frame.dirtyRows = dirtyRows;
+		frame.number = _producedFrames;
+
+		// a frame that is superseded before the consumer saw it must pass its dirty rows on,
+		// otherwise the consumer would keep stale rows from frames it skipped
+		if (_frames.publish())
+		{
+			++_droppedFrames;
+			_unconsumedRows = dirtyRows;
+		}
+		else
+		{
+			_unconsumedRows = changedRows;
+		}
+	}
+
+	void CPU::_synchronize(const std::function<void()>& function)
+	{
+		std::unique_lock<std::mutex> lock(_requestMutex);
+		_requestServiced.wait(lock, [this]() { return !_hasRequest; });
+
+		if (!_isInsideRun)
+		{
+			function();
 			return;
 		}
 
-		_keyStatus[KEY_MAP.at(key)] = false;
+		_request = &function;
+		_hasRequest = true;
+		_requestServiced.wait(lock, [this]() { return !_hasRequest; });
 	}
 
-	void CPU::_decode()
+	void CPU::_serviceRequest()
 	{
-		_opcode = _memory.readWord(_programCounter);
+		if (_request != nullptr)
+		{
+			(*_request)();
+			_request = nullptr;
+		}
+
+		_hasRequest = false;
+		_requestServiced.notify_all();
 	}
 
-	void CPU::_execute()
+	void CPU::_powerOn()
 	{
-		_canRefreshScreen = _is->step(_opcode);
+		// shares the pages of the cached image, they are copied once the program writes to them
+		_memory = _romImage->memory;
 
-		if (_registerSet.getDelayTimer() > 0)
+		_registerSet.reset();
+		_programCounter = { 0x0200 };
+		_framebuffer.fill({ 0x00 });
+		_keyStatus.fill({ false });
+		_cycleBudget = 0;
+
+		if (_rewindBuffer)
 		{
-			_registerSet.decDelayTimer();
+			_rewindBuffer->clear();
 		}
 
-		if (_registerSet.getSoundTimer() > 0)
+		_is = std::make_unique<IS>(_programCounter, _registerSet, _memory, _framebuffer, _keyStatus);
+		_is->setRandomState(_seed);
+
+		_unconsumedRows = ALL_ROWS_DIRTY;
+		_canRefreshScreen = true;
+	}
+
+	void CPU::_takeSnapshot(Snapshot& snapshot) const
+	{
+		snapshot.programCounter = _programCounter;
+		snapshot.registerSet = _registerSet;
+		_memory.copyTo(snapshot.memory);
+		snapshot.framebuffer = _framebuffer;
+		snapshot.keys = _keyStatus;
+		snapshot.randomState = _is ? _is->getRandomState() : 1;
+	}
+
+	void CPU::_restoreSnapshot(const Snapshot& snapshot)
+	{
+		if (!_is)
 		{
-			_registerSet.decSoundTimer();
+			_is = std::make_unique<IS>(_programCounter, _registerSet, _memory, _framebuffer, _keyStatus);
 		}
+
+		_programCounter = snapshot.programCounter;
+		_registerSet = snapshot.registerSet;
+		_memory.restore(snapshot.memory);
+		_framebuffer = snapshot.framebuffer;
+		_keyStatus = snapshot.keys;
+		_is->setRandomState(snapshot.randomState);
+		_is->clearFault();
+
+		// the whole screen may differ from what was presented last
+		_is->markDirty(ALL_ROWS_DIRTY);
+		_unconsumedRows = ALL_ROWS_DIRTY;
+		_canRefreshScreen = true;
+	}
+
+	void CPU::_processInput()
+	{
+		// events are still drained during a replay so they do not pile up, but the movie decides the keys
+		InputEvent event;
+		uint64_t now = 0;
+
+		while (_inputQueue.pop(event))
+		{
+			// events queued without a timestamp are not measured
+			if (event.timestamp != 0)
+			{
+				if (now == 0)
+				{
+					now = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+				}
+
+				_inputLatency.record(now > event.timestamp ? now - event.timestamp : 0);
+			}
+
+			if (!_isReplaying)
+			{
+				_keyStatus[event.key] = event.isPressed;
+			}
+		}
+	}
+
+	bool CPU::_queueKey(int key, bool isPressed)
+	{
+		const auto mappedKey = _keyMap.lookup(key);
+		if (mappedKey == KeyMap::NO_KEY)
+		{
+			return false;
+		}
+
+		const auto timestamp = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch());
+		return queueInput({ static_cast<uint64_t>(timestamp.count()), mappedKey, isPressed });
 	}
 
 	void CPU::_cycle()
 	{
-		_decode();
-		_execute();
+		_processInput();
+
+		if (_is->run(1, _dispatchMode))
+		{
+			_canRefreshScreen = true;
+		}
+
+		_executedInstructions = _executedInstructions + _is->getExecutedCount();
+	}
+
+	size_t CPU::_runFrame()
+	{
+		// one frame of virtual time: an instruction or cycle budget followed by a single 60 Hz timer tick
+		size_t instructionsPerFrame = std::max<size_t>(1, _targetInstructionsPerSecond / TIMER_FREQUENCY);
+
+		_processInput();
+
+		if (_isReplaying)
+		{
+			setKeyMask(_keyStatus, _replay.frames[_replayFrame]);
+			_isReplaying = ++_replayFrame < _replay.frames.size();
+		}
+
+		if (_isRecording)
+		{
+			_recording.frames.push_back(getKeyMask(_keyStatus));
+		}
+
+		bool hasDrawn = false;
+		if (_timingMode == TimingMode::Cycles)
+		{
+			_cycleBudget += _cycleTable.cyclesPerSecond;
+			instructionsPerFrame = 0;
+			hasDrawn = _is->runCycles(_cycleTable, _cycleBudget, instructionsPerFrame);
+		}
+		else
+		{
+			hasDrawn = _is->run(instructionsPerFrame, _dispatchMode);
+			instructionsPerFrame = _is->getExecutedCount();
+		}
+		_executedInstructions = _executedInstructions + instructionsPerFrame;
+		++_emulatedFrames;
+		if (hasDrawn)
+		{
+			_canRefreshScreen = true;
+		}
+
+#ifdef QCHIP8_PROFILE
+		_is->getProfiler().endFrame(hasDrawn);
+#endif
+
+		_registerSet.tickTimers();
+
+		// a halted machine does not change anymore, and its program counter would not pass the snapshot checks
+		if (_rewindBuffer && !_is->isHalted())
+		{
+			_takeSnapshot(_rewindSnapshot);
+			_rewindBuffer->push(_rewindSnapshot);
+		}
+
+		return instructionsPerFrame;
 	}
 }
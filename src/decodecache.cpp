@@ -0,0 +1,38 @@
+#include "decodecache.h"
+#include <algorithm>
+
+namespace Chip8
+{
+	DecodeCache::DecodeCache(Memory& memory) : _memory(memory)
+	{
+		invalidateAll();
+		_memory.addObserver(this);
+	}
+
+	DecodeCache::~DecodeCache()
+	{
+		_memory.removeObserver(this);
+	}
+
+	void DecodeCache::invalidateAll()
+	{
+		_instructions.fill({ Operation::Undecoded, 0, 0, 0, 0, 0 });
+	}
+
+	void DecodeCache::onMemoryWritten(size_t offset, size_t length)
+	{
+		if (length == 0)
+		{
+			return;
+		}
+
+		// an instruction starting one byte before the written range overlaps it as well
+		const size_t first = offset > 0 ? offset - 1 : 0;
+		const size_t last = std::min(offset + length, Memory::MEMORY_SIZE);
+
+		for (size_t i = first; i < last; ++i)
+		{
+			_instructions[i].operation = Operation::Undecoded;
+		}
+	}
+}
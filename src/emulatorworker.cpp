@@ -1,49 +1,89 @@
 #include "emulatorworker.h"
+#include <QFile>
 #include <utility>
 
+#if defined(QCHIP8_TRACE) || defined(QCHIP8_PROFILE)
+#include <iostream>
+#endif
+
 EmulatorWorker::EmulatorWorker(QObject* parent) : QObject(parent)
 {
 }
 
-void EmulatorWorker::setROM(QString filename)
+bool EmulatorWorker::setROM(QString filename)
 {
 	_emulator.reset();
-	_emulator.setROM(std::move(filename));
-	_emulator.loadROM();
-	connect(&_emulator, &Chip8::CPU::refreshScreen, this, &EmulatorWorker::onRefreshScreen);
+	_emulator.setROM(QFile::encodeName(filename).toStdString());
+	return _emulator.loadROM();
 }
 
 void EmulatorWorker::keyDown(int key)
 {
-	QMutexLocker locker(&_mutex);
 	_emulator.keyDown(key);
 }
 
 void EmulatorWorker::keyUp(int key)
 {
-	QMutexLocker locker(&_mutex);
 	_emulator.keyUp(key);
 }
 
-void EmulatorWorker::onRefreshScreen(Chip8::FrameBuffer framebuffer)
+void EmulatorWorker::setExecutionMode(Chip8::ExecutionMode mode)
+{
+	_emulator.setExecutionMode(mode);
+}
+
+void EmulatorWorker::setTimingMode(Chip8::TimingMode mode)
+{
+	_emulator.setTimingMode(mode);
+}
+
+void EmulatorWorker::setKeyMap(const Chip8::KeyMap& keyMap)
+{
+	_emulator.setKeyMap(keyMap);
+}
+
+void EmulatorWorker::setRewindLength(size_t frames)
+{
+	_emulator.setRewindLength(frames);
+}
+
+void EmulatorWorker::setRewinding(bool isRewinding)
 {
-	// forward message
-	emit refreshScreen(framebuffer);
+	_emulator.setRewinding(isRewinding);
 }
 
 void EmulatorWorker::onRunEmulation()
 {
 	_emulator.reset();
+
+	// there is no machine to run, trace or profile without a ROM
+	if (!_emulator.isLoaded())
+	{
+		emit finishedEmulation();
+		return;
+	}
+
+#ifdef QCHIP8_TRACE
+	_emulator.getTrace().setEnabled(true);
+#endif
+
 	_emulator.run();
 
+#ifdef QCHIP8_TRACE
+	// print the most recently executed instructions once the emulation thread is done
+	_emulator.getTrace().dump(std::clog);
+#endif
+
+#ifdef QCHIP8_PROFILE
+	_emulator.getProfiler().dumpFlat(std::clog);
+#endif
+
 	emit finishedEmulation();
 }
 
 void EmulatorWorker::onStopEmulation()
 {
-	_mutex.lock();
 	_emulator.stop();
-	_mutex.unlock();
 
 	emit finishedEmulation();
 }
@@ -52,3 +92,53 @@ bool EmulatorWorker::isRunning() const
 {
 	return _emulator.isRunning();
 }
+
+double EmulatorWorker::getInstructionsPerSecond() const
+{
+	return _emulator.getInstructionsPerSecond();
+}
+
+Chip8::FrameStatistics EmulatorWorker::getFrameStatistics() const
+{
+	return _emulator.getFrameStatistics();
+}
+
+Chip8::RuntimeMetrics EmulatorWorker::getMetrics() const
+{
+	return _emulator.getMetrics();
+}
+
+bool EmulatorWorker::acquireFrame()
+{
+	return _emulator.acquireFrame();
+}
+
+const Chip8::Frame& EmulatorWorker::getPresentedFrame() const
+{
+	return _emulator.getPresentedFrame();
+}
+
+void EmulatorWorker::saveSnapshot(Chip8::Snapshot& snapshot)
+{
+	_emulator.saveSnapshot(snapshot);
+}
+
+void EmulatorWorker::loadSnapshot(const Chip8::Snapshot& snapshot)
+{
+	_emulator.loadSnapshot(snapshot);
+}
+
+void EmulatorWorker::startRecording()
+{
+	_emulator.startRecording();
+}
+
+void EmulatorWorker::stopRecording(Chip8::Movie& movie)
+{
+	_emulator.stopRecording(movie);
+}
+
+bool EmulatorWorker::startReplay(const Chip8::Movie& movie)
+{
+	return _emulator.startReplay(movie);
+}
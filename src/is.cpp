@@ -1,451 +1,690 @@
 #include "is.h"
-#include <QDebug>
-#include <QRandomGenerator>
+#include <algorithm>
 
 namespace Chip8
 {
-	IS::IS(Word& programCounter, RegisterSet& registerSet, Memory& memory, FrameBuffer& framebuffer, KeyBuffer& keybuffer, QObject* parent) :
-		QObject(parent),
+	IS::IS(Word& programCounter, RegisterSet& registerSet, Memory& memory, FrameBuffer& framebuffer, KeyBuffer& keybuffer) :
 		_programCounter(programCounter),
 		_registerSet(registerSet),
 		_memory(memory),
 		_framebuffer(framebuffer),
-		_keybuffer(keybuffer)
+		_keybuffer(keybuffer),
+		_dirtyRows(ALL_ROWS_DIRTY),
+		_executedCount(0),
+		_fault(Fault::None),
+		_decodeCache(memory),
+		_randomEngine(std::random_device{}())
 	{
 	}
 
+	// Operation::Undecoded never leaves the decode cache, it is mapped to the no-op handler for completeness
+	const IS::Handler IS::HANDLERS[OPERATION_COUNT] = {
+		&IS::_executeUnknown,
+#define CHIP8_HANDLER_ENTRY(name) &IS::_execute##name,
+		CHIP8_OPERATIONS(CHIP8_HANDLER_ENTRY)
+#undef CHIP8_HANDLER_ENTRY
+	};
+
 	bool IS::step(const Word& opcode)
 	{
-		bool refreshFlag = false;
+		return execute(decodeInstruction(opcode));
+	}
 
-		const Byte registerX = (opcode & 0x0F00) >> 8;
-		const Byte registerY = (opcode & 0x00F0) >> 4;
-		const Word nnn = opcode & 0x0FFF;
-		const Byte nn = opcode & 0x00FF;
-		const Byte n = opcode & 0x000F;
+	bool IS::execute(const Instruction& instruction)
+	{
+		switch (instruction.operation)
+		{
+#define CHIP8_DISPATCH_CASE(name) case Operation::name: return _execute##name(instruction);
+		CHIP8_OPERATIONS(CHIP8_DISPATCH_CASE)
+#undef CHIP8_DISPATCH_CASE
+		default:
+			return false;
+		}
+	}
+
+	bool IS::run(size_t count, DispatchMode mode)
+	{
+		switch (mode)
+		{
+		case DispatchMode::Table:
+			return _runTable(count);
+		case DispatchMode::Threaded:
+			return _runThreaded(count);
+		case DispatchMode::Block:
+			return _runBlocks(count);
+		default:
+			return _runSwitch(count);
+		}
+	}
 
-		qDebug() << QString::number(_programCounter, 16) << "\t" << QString::number(opcode, 16) << "\t"
-			<< registerX
-			<< "\t"
-			<< registerY
-			<< "\t"
-			<< QString::number(nnn, 16)
-			<< "\t"
-			<< QString::number(nn, 16)
-			<< "\t"
-			<< QString::number(n, 16);
+	size_t IS::getExecutedCount() const
+	{
+		return _executedCount;
+	}
 
-		switch (opcode & 0xF000)
+	Fault IS::getFault() const
+	{
+		if (_fault == Fault::None && _programCounter > Memory::MEMORY_SIZE - 2)
 		{
-		case 0x0000:
+			return Fault::ProgramCounter;
+		}
+
+		return _fault;
+	}
+
+	void IS::clearFault()
+	{
+		_fault = Fault::None;
+	}
+
+	bool IS::runCycles(const CycleTable& table, int64_t& budget, size_t& executed)
+	{
+		bool refreshFlag = false;
+
+		while (budget > 0)
 		{
-			switch (opcode & 0x000F)
-			{
-			case 0x0000:
+			if (isHalted())
 			{
-				_framebuffer.fill(0x00);
-				refreshFlag = true;
-				_stepProgramCounterByte();
-
+				budget = 0;
 				break;
 			}
-			case 0x000E:
-			{
-				_programCounter = _registerSet.popStack();
-				_stepProgramCounterByte();
 
+			CHIP8_TRACE(_trace, _programCounter, _memory.readWord(_programCounter));
+			const Instruction instruction = _decodeCache.fetch(_programCounter);
+			CHIP8_PROFILE(_profiler, _programCounter, instruction.operation);
+			refreshFlag |= execute(instruction);
+			++executed;
+
+			if (instruction.operation == Operation::Draw && table.waitForVBlank)
+			{
+				// the rest of the frame is spent waiting, an earlier overrun is still owed
+				budget = std::min<int64_t>(budget, 0);
 				break;
 			}
-			}
 
-			break;
+			const auto cost = std::max<uint32_t>(1, table.costs[static_cast<size_t>(instruction.operation)]);
+			budget -= static_cast<int64_t>(cost) * CycleTable::FRAMES_PER_SECOND;
 		}
-		case 0x1000:
-		{
-			_programCounter = nnn;
 
-			break;
+		return refreshFlag;
+	}
+
+	DirtyRows IS::takeDirtyRows()
+	{
+		const auto dirtyRows = _dirtyRows;
+		_dirtyRows = 0;
+
+		return dirtyRows;
+	}
+
+	void IS::markDirty(DirtyRows rows)
+	{
+		_dirtyRows |= rows;
+	}
+
+	uint32_t IS::getRandomState() const
+	{
+		return _randomEngine.getState();
+	}
+
+	void IS::setRandomState(uint32_t state)
+	{
+		_randomEngine.setState(state);
+	}
+
+	bool IS::isThreadedDispatchSupported()
+	{
+#ifdef QCHIP8_COMPUTED_GOTO
+		return true;
+#else
+		return false;
+#endif
+	}
+
+#ifdef QCHIP8_TRACE
+	TraceBuffer& IS::getTrace()
+	{
+		return _trace;
+	}
+#endif
+
+#ifdef QCHIP8_PROFILE
+	Profiler& IS::getProfiler()
+	{
+		return _profiler;
+	}
+#endif
+
+	bool IS::_runSwitch(size_t count)
+	{
+		bool refreshFlag = false;
+		size_t i = 0;
+
+		for (; i < count && !isHalted(); ++i)
+		{
+			CHIP8_TRACE(_trace, _programCounter, _memory.readWord(_programCounter));
+			const Instruction instruction = _decodeCache.fetch(_programCounter);
+			CHIP8_PROFILE(_profiler, _programCounter, instruction.operation);
+			refreshFlag |= execute(instruction);
 		}
-		case 0x2000:
+
+		_executedCount = i;
+
+		return refreshFlag;
+	}
+
+	bool IS::_runTable(size_t count)
+	{
+		bool refreshFlag = false;
+		size_t i = 0;
+
+		for (; i < count && !isHalted(); ++i)
 		{
-			_registerSet.pushStack(_programCounter);
-			_programCounter = nnn;
+			CHIP8_TRACE(_trace, _programCounter, _memory.readWord(_programCounter));
+			const Instruction instruction = _decodeCache.fetch(_programCounter);
+			CHIP8_PROFILE(_profiler, _programCounter, instruction.operation);
+			refreshFlag |= (this->*HANDLERS[static_cast<size_t>(instruction.operation)])(instruction);
+		}
 
-			break;
+		_executedCount = i;
+
+		return refreshFlag;
+	}
+
+	bool IS::_runThreaded(size_t count)
+	{
+#ifdef QCHIP8_COMPUTED_GOTO
+		// every handler jumps straight to the next one instead of returning to a shared dispatch loop
+		static void* const LABELS[OPERATION_COUNT] = {
+			&&executeUnknown,
+#define CHIP8_THREADED_LABEL(name) &&execute##name,
+			CHIP8_OPERATIONS(CHIP8_THREADED_LABEL)
+#undef CHIP8_THREADED_LABEL
+		};
+
+		bool refreshFlag = false;
+		size_t remaining = count;
+		Instruction instruction;
+
+#define CHIP8_THREADED_DISPATCH() \
+		if (remaining == 0 || isHalted()) \
+		{ \
+			_executedCount = count - remaining; \
+			return refreshFlag; \
+		} \
+		--remaining; \
+		CHIP8_TRACE(_trace, _programCounter, _memory.readWord(_programCounter)); \
+		instruction = _decodeCache.fetch(_programCounter); \
+		CHIP8_PROFILE(_profiler, _programCounter, instruction.operation); \
+		goto *LABELS[static_cast<size_t>(instruction.operation)]
+
+		CHIP8_THREADED_DISPATCH();
+
+#define CHIP8_THREADED_HANDLER(name) \
+	execute##name: \
+		refreshFlag |= _execute##name(instruction); \
+		CHIP8_THREADED_DISPATCH();
+
+		CHIP8_OPERATIONS(CHIP8_THREADED_HANDLER)
+#undef CHIP8_THREADED_HANDLER
+#undef CHIP8_THREADED_DISPATCH
+#else
+		return _runTable(count);
+#endif
+	}
+
+	bool IS::_runBlocks(size_t count)
+	{
+		if (!_blockCache)
+		{
+			_blockCache = std::make_unique<BlockCache>(_memory, _decodeCache);
 		}
-		case 0x3000:
+
+		bool refreshFlag = false;
+		size_t remaining = count;
+
+		// the body ends before the last word of memory, so only the start of a block needs to be checked
+		while (remaining > 0 && !isHalted())
 		{
-			const auto regX = _registerSet.getRegisterValue(registerX);
-			if (regX == nn)
+			const auto& block = _blockCache->lookup(_programCounter);
+			const Instruction* code = _blockCache->code(block);
+
+			// the body only contains linear instructions, so the program counter is only written once per block
+			const size_t length = std::min<size_t>(block.length, remaining);
+			for (size_t i = 0; i < length; ++i)
 			{
-				_stepProgramCounterByte();
+				CHIP8_TRACE(_trace, block.start + i * 2, _memory.readWord(block.start + i * 2));
+				CHIP8_PROFILE(_profiler, block.start + i * 2, code[i].operation);
+				_applyLinear(code[i]);
 			}
 
-			_stepProgramCounterByte();
+			_programCounter = static_cast<Word>(block.start + length * 2);
+			remaining -= length;
 
-			break;
-		}
-		case 0x4000:
-		{
-			const auto regX = _registerSet.getRegisterValue(registerX);
-			if (regX != nn)
+			if (remaining > 0)
 			{
-				_stepProgramCounterByte();
+				CHIP8_TRACE(_trace, _programCounter, _memory.readWord(_programCounter));
+				CHIP8_PROFILE(_profiler, _programCounter, block.terminator.operation);
+				refreshFlag |= execute(block.terminator);
+				--remaining;
 			}
+		}
 
-			_stepProgramCounterByte();
+		_executedCount = count - remaining;
+
+		return refreshFlag;
+	}
 
+	void IS::_applyLinear(const Instruction& instruction)
+	{
+		switch (instruction.operation)
+		{
+#define CHIP8_APPLY_CASE(name) case Operation::name: _apply##name(instruction); break;
+		CHIP8_LINEAR_OPERATIONS(CHIP8_APPLY_CASE)
+#undef CHIP8_APPLY_CASE
+		default:
 			break;
 		}
-		case 0x5000:
+	}
+
+	void IS::_stepProgramCounterByte()
+	{
+		_programCounter += 2;
+	}
+
+	bool IS::_checkAddressRange(size_t length)
+	{
+		if (static_cast<size_t>(_registerSet.getAddressRegister()) + length > Memory::MEMORY_SIZE)
 		{
-			const auto regX = _registerSet.getRegisterValue(registerX);
-			const auto regY = _registerSet.getRegisterValue(registerY);
+			_fault = Fault::AddressRegister;
+			return false;
+		}
 
-			if (regX == regY)
-			{
-				_stepProgramCounterByte();
-			}
+		return true;
+	}
 
-			_stepProgramCounterByte();
+	bool IS::_executeUnknown(const Instruction&)
+	{
+		// unsupported opcodes leave the machine untouched
+		return false;
+	}
 
-			break;
-		}
-		case 0x6000:
+	bool IS::_executeClearScreen(const Instruction&)
+	{
+		_framebuffer.fill(0x00);
+		_dirtyRows = ALL_ROWS_DIRTY;
+		_stepProgramCounterByte();
+
+		return true;
+	}
+
+	bool IS::_executeReturn(const Instruction&)
+	{
+		if (_registerSet.getStackPointer() == 0)
 		{
-			_registerSet.setRegisterValue(registerX, nn);
-			_stepProgramCounterByte();
+			_fault = Fault::StackUnderflow;
+			return false;
+		}
 
-			break;
+		_programCounter = _registerSet.popStack();
+		_stepProgramCounterByte();
+
+#ifdef QCHIP8_PROFILE
+		_profiler.updateCallStack(_registerSet, _memory);
+#endif
+
+		return false;
+	}
+
+	bool IS::_executeJump(const Instruction& instruction)
+	{
+		_programCounter = instruction.nnn;
+
+		return false;
+	}
+
+	bool IS::_executeCall(const Instruction& instruction)
+	{
+		if (_registerSet.getStackPointer() >= STACK_SIZE - 1)
+		{
+			_fault = Fault::StackOverflow;
+			return false;
 		}
-		case 0x7000:
+
+		_registerSet.pushStack(_programCounter);
+		_programCounter = instruction.nnn;
+
+#ifdef QCHIP8_PROFILE
+		_profiler.updateCallStack(_registerSet, _memory);
+#endif
+
+		return false;
+	}
+
+	bool IS::_executeSkipEqualImmediate(const Instruction& instruction)
+	{
+		const auto regX = _registerSet.getRegisterValue(instruction.x);
+		if (regX == instruction.nn)
 		{
-			_registerSet.addRegisterValue(registerX, nn);
 			_stepProgramCounterByte();
+		}
 
-			break;
+		_stepProgramCounterByte();
+
+		return false;
+	}
+
+	bool IS::_executeSkipNotEqualImmediate(const Instruction& instruction)
+	{
+		const auto regX = _registerSet.getRegisterValue(instruction.x);
+		if (regX != instruction.nn)
+		{
+			_stepProgramCounterByte();
 		}
-		case 0x8000:
+
+		_stepProgramCounterByte();
+
+		return false;
+	}
+
+	bool IS::_executeSkipEqualRegister(const Instruction& instruction)
+	{
+		const auto regX = _registerSet.getRegisterValue(instruction.x);
+		const auto regY = _registerSet.getRegisterValue(instruction.y);
+
+		if (regX == regY)
 		{
-			switch (opcode & 0x000F)
-			{
-			case 0x0000:
-			{
-				_registerSet.setRegisterValue(registerX, _registerSet.getRegisterValue(registerY));
-				_stepProgramCounterByte();
+			_stepProgramCounterByte();
+		}
 
-				break;
-			}
-			case 0x0001:
-			{
-				_registerSet.setRegisterValue(registerX, _registerSet.getRegisterValue(registerX) | _registerSet.getRegisterValue(registerY));
-				_stepProgramCounterByte();
+		_stepProgramCounterByte();
 
-				break;
-			}
-			case 0x0002:
-			{
-				_registerSet.setRegisterValue(registerX, _registerSet.getRegisterValue(registerX) & _registerSet.getRegisterValue(registerY));
-				_stepProgramCounterByte();
+		return false;
+	}
 
-				break;
-			}
-			case 0x0003:
-			{
-				_registerSet.setRegisterValue(registerX, _registerSet.getRegisterValue(registerX) ^ _registerSet.getRegisterValue(registerY));
-				_stepProgramCounterByte();
+	void IS::_applyLoadImmediate(const Instruction& instruction)
+	{
+		_registerSet.setRegisterValue(instruction.x, instruction.nn);
+	}
 
-				break;
-			}
-			case 0x0004:
-			{
-				_registerSet.addRegisterValue(registerX, _registerSet.getRegisterValue(registerY));
-
-				if (_registerSet.getRegisterValue(registerY) + _registerSet.getRegisterValue(registerX) > 0xFF)
-				{
-					_registerSet.setRegisterValue(0xF, 1);
-				}
-				else
-				{
-					_registerSet.setRegisterValue(0xF, 0);
-				}
-
-				_stepProgramCounterByte();
-				break;
-			}
-			case 0x0005:
-			{
-				_registerSet.subRegisterValue(registerX, _registerSet.getRegisterValue(registerY));
-
-				if (_registerSet.getRegisterValue(registerY) > _registerSet.getRegisterValue(registerX))
-				{
-					_registerSet.setRegisterValue(0xF, 0);
-				}
-				else
-				{
-					_registerSet.setRegisterValue(0xF, 1);
-				}
-
-				_stepProgramCounterByte();
-				break;
-			}
-			case 0x0006:
-			{
-				_registerSet.setRegisterValue(0xF, _registerSet.getRegisterValue(registerX) & 0x01);
-				_registerSet.shrRegisterValue(registerX, 1);
+	void IS::_applyAddImmediate(const Instruction& instruction)
+	{
+		_registerSet.addRegisterValue(instruction.x, instruction.nn);
+	}
 
-				_stepProgramCounterByte();
-				break;
-			}
-			case 0x0007:
-			{
-				if (_registerSet.getRegisterValue(registerX) > _registerSet.getRegisterValue(registerY))
-				{
-					_registerSet.setRegisterValue(0xF, 0);
-				}
-				else
-				{
-					_registerSet.setRegisterValue(0xF, 1);
-				}
-
-				_registerSet.setRegisterValue(registerX, _registerSet.getRegisterValue(registerY) - _registerSet.getRegisterValue(registerX));
-				_stepProgramCounterByte();
+	void IS::_applyMove(const Instruction& instruction)
+	{
+		_registerSet.setRegisterValue(instruction.x, _registerSet.getRegisterValue(instruction.y));
+	}
 
-				break;
-			}
-			case 0x000E:
-			{
-				_registerSet.setRegisterValue(0xF, _registerSet.getRegisterValue(registerX) >> 7);
-				_registerSet.shlRegisterValue(registerX, 1);
+	void IS::_applyOr(const Instruction& instruction)
+	{
+		_registerSet.setRegisterValue(instruction.x, _registerSet.getRegisterValue(instruction.x) | _registerSet.getRegisterValue(instruction.y));
+	}
 
-				_stepProgramCounterByte();
-				break;
-			}
-			}
+	void IS::_applyAnd(const Instruction& instruction)
+	{
+		_registerSet.setRegisterValue(instruction.x, _registerSet.getRegisterValue(instruction.x) & _registerSet.getRegisterValue(instruction.y));
+	}
 
-			break;
+	void IS::_applyXor(const Instruction& instruction)
+	{
+		_registerSet.setRegisterValue(instruction.x, _registerSet.getRegisterValue(instruction.x) ^ _registerSet.getRegisterValue(instruction.y));
+	}
+
+	void IS::_applyAdd(const Instruction& instruction)
+	{
+		_registerSet.addRegisterValue(instruction.x, _registerSet.getRegisterValue(instruction.y));
+
+		if (_registerSet.getRegisterValue(instruction.y) + _registerSet.getRegisterValue(instruction.x) > 0xFF)
+		{
+			_registerSet.setRegisterValue(0xF, 1);
 		}
-		case 0x9000:
+		else
 		{
-			if (_registerSet.getRegisterValue(registerX) != _registerSet.getRegisterValue(registerY))
-			{
-				_stepProgramCounterByte();
-			}
+			_registerSet.setRegisterValue(0xF, 0);
+		}
+	}
 
-			_stepProgramCounterByte();
+	void IS::_applySub(const Instruction& instruction)
+	{
+		_registerSet.subRegisterValue(instruction.x, _registerSet.getRegisterValue(instruction.y));
 
-			break;
+		if (_registerSet.getRegisterValue(instruction.y) > _registerSet.getRegisterValue(instruction.x))
+		{
+			_registerSet.setRegisterValue(0xF, 0);
 		}
-		case 0xA000:
+		else
 		{
-			_registerSet.setAddressRegister(nnn);
-			_stepProgramCounterByte();
-
-			break;
+			_registerSet.setRegisterValue(0xF, 1);
 		}
-		case 0xB000:
+	}
+
+	void IS::_applyShiftRight(const Instruction& instruction)
+	{
+		_registerSet.setRegisterValue(0xF, _registerSet.getRegisterValue(instruction.x) & 0x01);
+		_registerSet.shrRegisterValue(instruction.x, 1);
+	}
+
+	void IS::_applySubReverse(const Instruction& instruction)
+	{
+		if (_registerSet.getRegisterValue(instruction.x) > _registerSet.getRegisterValue(instruction.y))
 		{
-			_programCounter = nnn + _registerSet.getRegisterValue(0);
-			break;
+			_registerSet.setRegisterValue(0xF, 0);
 		}
-		case 0xC000:
+		else
 		{
-			const auto random = static_cast<Byte>(QRandomGenerator::global()->bounded(0x00, 0xFF));
-			_registerSet.setRegisterValue(registerX, random & nn);
+			_registerSet.setRegisterValue(0xF, 1);
+		}
+
+		_registerSet.setRegisterValue(instruction.x, _registerSet.getRegisterValue(instruction.y) - _registerSet.getRegisterValue(instruction.x));
+	}
+
+	void IS::_applyShiftLeft(const Instruction& instruction)
+	{
+		_registerSet.setRegisterValue(0xF, _registerSet.getRegisterValue(instruction.x) >> 7);
+		_registerSet.shlRegisterValue(instruction.x, 1);
+	}
 
+	bool IS::_executeSkipNotEqualRegister(const Instruction& instruction)
+	{
+		if (_registerSet.getRegisterValue(instruction.x) != _registerSet.getRegisterValue(instruction.y))
+		{
 			_stepProgramCounterByte();
-			break;
 		}
-		case 0xD000:
-		{
-			const auto posX = _registerSet.getRegisterValue(registerX);
-			const auto posY = _registerSet.getRegisterValue(registerY);
-			const auto height = n;
-			const auto addressRegister = _registerSet.getAddressRegister();
 
-			_registerSet.setRegisterValue(0xF, 0);
+		_stepProgramCounterByte();
 
-			for (size_t vy = 0; vy < height; ++vy)
-			{
-				const auto pixelIndex = addressRegister + vy;
-				const unsigned short pixel = _memory[pixelIndex];
-
-				for (size_t vx = 0; vx < SPRITE_WIDTH; ++vx)
-				{
-					size_t index = (posX + vx + ((posY + vy) * DISPLAY_WIDTH));
-					if ((pixel & (0x80 >> vx)) != 0)
-					{
-						// implement wraparound
-						if (index > DISPLAY_SIZE)
-						{
-							index %= DISPLAY_SIZE;
-						}
-
-						if (index <= _framebuffer.size())
-						{
-							if (_framebuffer[index] == 1)
-							{
-								_registerSet.setRegisterValue(0xF, 1);
-							}
-
-							_framebuffer[index] ^= 1;
-						}
-					}
-				}
-			}
+		return false;
+	}
 
-			refreshFlag = true;
-			_stepProgramCounterByte();
+	void IS::_applyLoadAddress(const Instruction& instruction)
+	{
+		_registerSet.setAddressRegister(instruction.nnn);
+	}
 
-			break;
+	bool IS::_executeJumpOffset(const Instruction& instruction)
+	{
+		_programCounter = instruction.nnn + _registerSet.getRegisterValue(0);
+
+		return false;
+	}
+
+	void IS::_applyRandom(const Instruction& instruction)
+	{
+		// 0x00 to 0xFE computed directly, std::uniform_int_distribution differs between standard libraries
+		const auto random = static_cast<Byte>(_randomEngine() % 0xFF);
+		_registerSet.setRegisterValue(instruction.x, random & instruction.nn);
+	}
+
+	bool IS::_executeDraw(const Instruction& instruction)
+	{
+		// the sprite position wraps around, pixels beyond the right and bottom edges reappear on the opposite side
+		const size_t posX = _registerSet.getRegisterValue(instruction.x) % DISPLAY_WIDTH;
+		const size_t posY = _registerSet.getRegisterValue(instruction.y) % DISPLAY_HEIGHT;
+		const auto height = instruction.n;
+		const auto addressRegister = _registerSet.getAddressRegister();
+
+		if (!_checkAddressRange(height))
+		{
+			return false;
 		}
-		case 0xE000:
+
+		FrameRow collision = 0;
+
+		for (size_t vy = 0; vy < height; ++vy)
 		{
-			switch (nn)
-			{
-			case 0x009E:
-			{
-				const auto regX = _registerSet.getRegisterValue(registerX);
-				if (_keybuffer[regX])
-				{
-					// key was pressed
-					_stepProgramCounterByte();
-				}
-
-				_stepProgramCounterByte();
-				break;
-			}
-			case 0x00A1:
-			{
-				const auto regX = _registerSet.getRegisterValue(registerX);
-				if (!_keybuffer[regX])
-				{
-					// key was pressed
-					_stepProgramCounterByte();
-				}
-
-				_stepProgramCounterByte();
-				break;
-			}
-			}
+			// move the 8 pixel wide sprite row to the left edge, then rotate it into place
+			const FrameRow sprite = static_cast<FrameRow>(_memory[addressRegister + vy]) << (DISPLAY_WIDTH - SPRITE_WIDTH);
+			const FrameRow spriteRow = (sprite >> posX) | (sprite << ((DISPLAY_WIDTH - posX) % DISPLAY_WIDTH));
 
-			break;
+			auto& row = _framebuffer[(posY + vy) % DISPLAY_HEIGHT];
+			collision |= row & spriteRow;
+			row ^= spriteRow;
 		}
-		case 0xF000:
+
+		// mark the touched rows, rotated the same way as the rows themselves wrap around
+		const DirtyRows touchedRows = (static_cast<DirtyRows>(1) << height) - 1;
+		_dirtyRows |= (touchedRows << posY) | (touchedRows >> ((DISPLAY_HEIGHT - posY) % DISPLAY_HEIGHT));
+
+		_registerSet.setRegisterValue(0xF, collision != 0 ? 1 : 0);
+		_stepProgramCounterByte();
+
+		return true;
+	}
+
+	bool IS::_executeSkipKeyPressed(const Instruction& instruction)
+	{
+		const auto regX = _registerSet.getRegisterValue(instruction.x);
+		if (_keybuffer[regX % KEY_COUNT])
 		{
-			switch (nn)
-			{
-			case 0x0007:
-			{
-				_registerSet.setRegisterValue(registerX, _registerSet.getDelayTimer());
-				_stepProgramCounterByte();
+			// key was pressed
+			_stepProgramCounterByte();
+		}
 
-				break;
-			}
-			case 0x000A:
-			{
-				bool isPressed = false;
+		_stepProgramCounterByte();
 
-				for (size_t i = 0; i < KEY_COUNT; ++i)
-				{
-					if (_keybuffer[i])
-					{
-						_registerSet.setRegisterValue(registerX, i);
-						isPressed = true;
-					}
-				}
+		return false;
+	}
 
-				if (!isPressed)
-				{
-					break;
-				}
+	bool IS::_executeSkipKeyNotPressed(const Instruction& instruction)
+	{
+		const auto regX = _registerSet.getRegisterValue(instruction.x);
+		if (!_keybuffer[regX % KEY_COUNT])
+		{
+			// key was pressed
+			_stepProgramCounterByte();
+		}
 
-				_stepProgramCounterByte();
+		_stepProgramCounterByte();
 
-				break;
-			}
-			case 0x0015:
-			{
-				_registerSet.setDelayTimer(_registerSet.getRegisterValue(registerX));
-				_stepProgramCounterByte();
+		return false;
+	}
 
-				break;
-			}
-			case 0x0018:
-			{
-				_registerSet.setSoundTimer(_registerSet.getRegisterValue(registerX));
-				_stepProgramCounterByte();
+	void IS::_applyLoadDelayTimer(const Instruction& instruction)
+	{
+		_registerSet.setRegisterValue(instruction.x, _registerSet.getDelayTimer());
+	}
 
-				break;
-			}
-			case 0x001E:
-			{
-				_registerSet.incAddressRegister(_registerSet.getRegisterValue(registerX));
-				_stepProgramCounterByte();
+	bool IS::_executeWaitKey(const Instruction& instruction)
+	{
+		bool isPressed = false;
 
-				break;
-			}
-			case 0x0029:
+		for (size_t i = 0; i < KEY_COUNT; ++i)
+		{
+			if (_keybuffer[i])
 			{
-				_registerSet.setAddressRegister(_registerSet.getRegisterValue(registerX) * 0x5);
-				_stepProgramCounterByte();
-
-				break;
+				_registerSet.setRegisterValue(instruction.x, i);
+				isPressed = true;
 			}
-			case 0x0033:
-			{
-				const auto reg = _registerSet.getRegisterValue(registerX);
-				const auto addressRegister = _registerSet.getAddressRegister();
+		}
 
-				_memory[addressRegister] = reg / 100;
-				_memory[addressRegister + 1] = (reg / 10) % 10;
-				_memory[addressRegister + 2] = reg % 100 % 10;
+		if (!isPressed)
+		{
+			return false;
+		}
 
-				_stepProgramCounterByte();
-				break;
-			}
-			case 0x0055:
-			{
-				const auto addressRegister = _registerSet.getAddressRegister();
+		_stepProgramCounterByte();
 
-				for (size_t i = 0; i <= registerX; ++i)
-				{
-					_memory[addressRegister + i] = _registerSet.getRegisterValue(i);
-				}
+		return false;
+	}
 
-				_registerSet.incAddressRegister(static_cast<Word>(registerX) + 1);
-				_stepProgramCounterByte();
+	void IS::_applySetDelayTimer(const Instruction& instruction)
+	{
+		_registerSet.setDelayTimer(_registerSet.getRegisterValue(instruction.x));
+	}
 
-				break;
-			}
-			case 0x0065:
-			{
-				const auto addressRegister = _registerSet.getAddressRegister();
+	void IS::_applySetSoundTimer(const Instruction& instruction)
+	{
+		_registerSet.setSoundTimer(_registerSet.getRegisterValue(instruction.x));
+	}
+
+	void IS::_applyAddAddress(const Instruction& instruction)
+	{
+		_registerSet.incAddressRegister(_registerSet.getRegisterValue(instruction.x));
+	}
 
-				for (size_t i = 0; i <= registerX; ++i)
-				{
-					_registerSet.setRegisterValue(i, _memory[addressRegister + i]);
-				}
+	void IS::_applyLoadFont(const Instruction& instruction)
+	{
+		_registerSet.setAddressRegister(_registerSet.getRegisterValue(instruction.x) * 0x5);
+	}
 
-				_registerSet.incAddressRegister(static_cast<Word>(registerX) + 1);
-				_stepProgramCounterByte();
+	bool IS::_executeStoreBCD(const Instruction& instruction)
+	{
+		if (!_checkAddressRange(3))
+		{
+			return false;
+		}
 
-				break;
-			}
-			}
+		const auto reg = _registerSet.getRegisterValue(instruction.x);
+		const auto addressRegister = _registerSet.getAddressRegister();
 
-			break;
+		_memory.writeByte(addressRegister, reg / 100);
+		_memory.writeByte(addressRegister + 1, (reg / 10) % 10);
+		_memory.writeByte(addressRegister + 2, reg % 100 % 10);
+
+		_stepProgramCounterByte();
+
+		return false;
+	}
+
+	bool IS::_executeStoreRegisters(const Instruction& instruction)
+	{
+		if (!_checkAddressRange(static_cast<size_t>(instruction.x) + 1))
+		{
+			return false;
 		}
-		default:
-			//qDebug().noquote() << "Invalid opcode: " << QString::number(opcode, 16);
-			break;
+
+		const auto addressRegister = _registerSet.getAddressRegister();
+
+		for (size_t i = 0; i <= instruction.x; ++i)
+		{
+			_memory.writeByte(addressRegister + i, _registerSet.getRegisterValue(i));
 		}
 
-		return refreshFlag;
+		_registerSet.incAddressRegister(static_cast<Word>(instruction.x) + 1);
+		_stepProgramCounterByte();
+
+		return false;
 	}
 
-	void IS::_stepProgramCounterByte()
+	bool IS::_executeLoadRegisters(const Instruction& instruction)
 	{
-		_programCounter += 2;
+		if (!_checkAddressRange(static_cast<size_t>(instruction.x) + 1))
+		{
+			return false;
+		}
+
+		const auto addressRegister = _registerSet.getAddressRegister();
+
+		for (size_t i = 0; i <= instruction.x; ++i)
+		{
+			_registerSet.setRegisterValue(i, _memory[addressRegister + i]);
+		}
+
+		_registerSet.incAddressRegister(static_cast<Word>(instruction.x) + 1);
+		_stepProgramCounterByte();
+
+		return false;
 	}
 }
@@ -0,0 +1,187 @@
+#include "keymap.h"
+#include <algorithm>
+#include <cctype>
+#include <cstdlib>
+#include <utility>
+
+namespace Chip8
+{
+	namespace
+	{
+		struct NamedKey
+		{
+			const char* name;
+			int hostKey;
+		};
+
+		// Qt::Key values of the special keys that are useful on a controller-like layout
+		constexpr NamedKey NAMED_KEYS[] = {
+			{ "Space", 0x20 },
+			{ "Escape", KeyMap::SPECIAL_KEY_BASE + 0x00 },
+			{ "Tab", KeyMap::SPECIAL_KEY_BASE + 0x01 },
+			{ "Backspace", KeyMap::SPECIAL_KEY_BASE + 0x03 },
+			{ "Return", KeyMap::SPECIAL_KEY_BASE + 0x04 },
+			{ "Enter", KeyMap::SPECIAL_KEY_BASE + 0x05 },
+			{ "Insert", KeyMap::SPECIAL_KEY_BASE + 0x06 },
+			{ "Delete", KeyMap::SPECIAL_KEY_BASE + 0x07 },
+			{ "Home", KeyMap::SPECIAL_KEY_BASE + 0x10 },
+			{ "End", KeyMap::SPECIAL_KEY_BASE + 0x11 },
+			{ "Left", KeyMap::SPECIAL_KEY_BASE + 0x12 },
+			{ "Up", KeyMap::SPECIAL_KEY_BASE + 0x13 },
+			{ "Right", KeyMap::SPECIAL_KEY_BASE + 0x14 },
+			{ "Down", KeyMap::SPECIAL_KEY_BASE + 0x15 },
+			{ "PageUp", KeyMap::SPECIAL_KEY_BASE + 0x16 },
+			{ "PageDown", KeyMap::SPECIAL_KEY_BASE + 0x17 },
+			{ "Shift", KeyMap::SPECIAL_KEY_BASE + 0x20 },
+			{ "Control", KeyMap::SPECIAL_KEY_BASE + 0x21 },
+			{ "Alt", KeyMap::SPECIAL_KEY_BASE + 0x23 }
+		};
+
+		std::string trim(const std::string& text)
+		{
+			const auto first = text.find_first_not_of(" \t\r");
+			if (first == std::string::npos)
+			{
+				return {};
+			}
+
+			const auto last = text.find_last_not_of(" \t\r");
+			return text.substr(first, last - first + 1);
+		}
+
+		bool parseNumber(const std::string& text, long& value)
+		{
+			if (text.empty())
+			{
+				return false;
+			}
+
+			char* end = nullptr;
+			value = std::strtol(text.c_str(), &end, 0);
+
+			return end == text.c_str() + text.size();
+		}
+
+		// CHIP-8 keys are written as numbers or as a single hex digit
+		int parseKey(const std::string& text)
+		{
+			long value = -1;
+			if (text.size() == 1 && std::isxdigit(static_cast<unsigned char>(text[0])))
+			{
+				value = std::strtol(text.c_str(), nullptr, 16);
+			}
+			else if (!parseNumber(text, value))
+			{
+				return -1;
+			}
+
+			return value >= 0 && value < static_cast<long>(KEY_COUNT) ? static_cast<int>(value) : -1;
+		}
+	}
+
+	std::vector<KeyProfile> getBuiltinKeyProfiles()
+	{
+		// most games steer with 4/6 or 5/7/8/9, so the arrow keys cover both on top of the default layout
+		KeyMap arrows = DEFAULT_KEY_MAP;
+		arrows.map(parseHostKey("Up"), 0x5);
+		arrows.map(parseHostKey("Down"), 0x8);
+		arrows.map(parseHostKey("Left"), 0x7);
+		arrows.map(parseHostKey("Right"), 0x9);
+		arrows.map(parseHostKey("Space"), 0x6);
+
+		return {
+			{ "Default", DEFAULT_KEY_MAP },
+			{ "Arrow keys", arrows }
+		};
+	}
+
+	int parseHostKey(const std::string& name)
+	{
+		// Qt::Key uses the uppercase character code for letters
+		if (name.size() == 1)
+		{
+			return std::toupper(static_cast<unsigned char>(name[0]));
+		}
+
+		for (const auto& namedKey : NAMED_KEYS)
+		{
+			if (name == namedKey.name)
+			{
+				return namedKey.hostKey;
+			}
+		}
+
+		long value = -1;
+		if (!parseNumber(name, value) || value < 0)
+		{
+			return -1;
+		}
+
+		return static_cast<int>(value);
+	}
+
+	bool loadKeyProfiles(std::istream& stream, std::vector<KeyProfile>& profiles, size_t* errorLine)
+	{
+		std::vector<KeyProfile> loaded;
+		std::string line;
+		size_t lineNumber = 0;
+
+		while (std::getline(stream, line))
+		{
+			++lineNumber;
+			line = trim(line);
+
+			if (line.empty() || line[0] == '#' || line[0] == ';')
+			{
+				continue;
+			}
+
+			bool isValid = false;
+
+			if (line.front() == '[' && line.back() == ']')
+			{
+				const auto name = trim(line.substr(1, line.size() - 2));
+				isValid = !name.empty();
+
+				// a new profile starts out empty
+				loaded.push_back({ name, KeyMap() });
+			}
+			else if (const auto separator = line.find('='); separator != std::string::npos && !loaded.empty())
+			{
+				const auto hostKey = parseHostKey(trim(line.substr(0, separator)));
+				const auto key = parseKey(trim(line.substr(separator + 1)));
+
+				isValid = hostKey >= 0 && key >= 0 && loaded.back().keyMap.map(hostKey, static_cast<Byte>(key));
+			}
+
+			if (!isValid)
+			{
+				if (errorLine != nullptr)
+				{
+					*errorLine = lineNumber;
+				}
+
+				return false;
+			}
+		}
+
+		for (auto& profile : loaded)
+		{
+			const auto existing = std::find_if(profiles.begin(), profiles.end(), [&profile](const KeyProfile& other)
+			{
+				return other.name == profile.name;
+			});
+
+			if (existing != profiles.end())
+			{
+				*existing = std::move(profile);
+			}
+			else
+			{
+				profiles.push_back(std::move(profile));
+			}
+		}
+
+		return true;
+	}
+}
@@ -0,0 +1,735 @@
+#include "lockstep.h"
+#include "instruction.h"
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define QCHIP8_LOCKSTEP_AVX2
+#elif defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define QCHIP8_LOCKSTEP_SSE2
+#endif
+
+namespace Chip8
+{
+	namespace
+	{
+		// lane-wise byte arithmetic on the widest vectors the target supports, comparisons yield 0xFF or 0x00 per lane
+#if defined(QCHIP8_LOCKSTEP_AVX2)
+		struct ByteVector
+		{
+			constexpr static size_t WIDTH = 32;
+			__m256i value;
+
+			static ByteVector load(const Byte* source)
+			{
+				return { _mm256_loadu_si256(reinterpret_cast<const __m256i*>(source)) };
+			}
+
+			static ByteVector broadcast(Byte byte)
+			{
+				return { _mm256_set1_epi8(static_cast<char>(byte)) };
+			}
+
+			void store(Byte* target) const
+			{
+				_mm256_storeu_si256(reinterpret_cast<__m256i*>(target), value);
+			}
+		};
+
+		inline ByteVector operator+(ByteVector a, ByteVector b) { return { _mm256_add_epi8(a.value, b.value) }; }
+		inline ByteVector operator-(ByteVector a, ByteVector b) { return { _mm256_sub_epi8(a.value, b.value) }; }
+		inline ByteVector operator|(ByteVector a, ByteVector b) { return { _mm256_or_si256(a.value, b.value) }; }
+		inline ByteVector operator&(ByteVector a, ByteVector b) { return { _mm256_and_si256(a.value, b.value) }; }
+		inline ByteVector operator^(ByteVector a, ByteVector b) { return { _mm256_xor_si256(a.value, b.value) }; }
+		inline ByteVector select(ByteVector mask, ByteVector whenSet, ByteVector otherwise) { return { _mm256_blendv_epi8(otherwise.value, whenSet.value, mask.value) }; }
+		inline ByteVector equal(ByteVector a, ByteVector b) { return { _mm256_cmpeq_epi8(a.value, b.value) }; }
+		inline ByteVector minimum(ByteVector a, ByteVector b) { return { _mm256_min_epu8(a.value, b.value) }; }
+		inline ByteVector shiftRight(ByteVector a, int count) { return { _mm256_srl_epi16(a.value, _mm_cvtsi32_si128(count)) }; }
+#elif defined(QCHIP8_LOCKSTEP_SSE2)
+		struct ByteVector
+		{
+			constexpr static size_t WIDTH = 16;
+			__m128i value;
+
+			static ByteVector load(const Byte* source)
+			{
+				return { _mm_loadu_si128(reinterpret_cast<const __m128i*>(source)) };
+			}
+
+			static ByteVector broadcast(Byte byte)
+			{
+				return { _mm_set1_epi8(static_cast<char>(byte)) };
+			}
+
+			void store(Byte* target) const
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(target), value);
+			}
+		};
+
+		inline ByteVector operator+(ByteVector a, ByteVector b) { return { _mm_add_epi8(a.value, b.value) }; }
+		inline ByteVector operator-(ByteVector a, ByteVector b) { return { _mm_sub_epi8(a.value, b.value) }; }
+		inline ByteVector operator|(ByteVector a, ByteVector b) { return { _mm_or_si128(a.value, b.value) }; }
+		inline ByteVector operator&(ByteVector a, ByteVector b) { return { _mm_and_si128(a.value, b.value) }; }
+		inline ByteVector operator^(ByteVector a, ByteVector b) { return { _mm_xor_si128(a.value, b.value) }; }
+		inline ByteVector select(ByteVector mask, ByteVector whenSet, ByteVector otherwise) { return { _mm_or_si128(_mm_and_si128(mask.value, whenSet.value), _mm_andnot_si128(mask.value, otherwise.value)) }; }
+		inline ByteVector equal(ByteVector a, ByteVector b) { return { _mm_cmpeq_epi8(a.value, b.value) }; }
+		inline ByteVector minimum(ByteVector a, ByteVector b) { return { _mm_min_epu8(a.value, b.value) }; }
+		inline ByteVector shiftRight(ByteVector a, int count) { return { _mm_srl_epi16(a.value, _mm_cvtsi32_si128(count)) }; }
+#else
+		struct ByteVector
+		{
+			constexpr static size_t WIDTH = 1;
+			Byte value;
+
+			static ByteVector load(const Byte* source)
+			{
+				return { *source };
+			}
+
+			static ByteVector broadcast(Byte byte)
+			{
+				return { byte };
+			}
+
+			void store(Byte* target) const
+			{
+				*target = value;
+			}
+		};
+
+		inline ByteVector operator+(ByteVector a, ByteVector b) { return { static_cast<Byte>(a.value + b.value) }; }
+		inline ByteVector operator-(ByteVector a, ByteVector b) { return { static_cast<Byte>(a.value - b.value) }; }
+		inline ByteVector operator|(ByteVector a, ByteVector b) { return { static_cast<Byte>(a.value | b.value) }; }
+		inline ByteVector operator&(ByteVector a, ByteVector b) { return { static_cast<Byte>(a.value & b.value) }; }
+		inline ByteVector operator^(ByteVector a, ByteVector b) { return { static_cast<Byte>(a.value ^ b.value) }; }
+		inline ByteVector select(ByteVector mask, ByteVector whenSet, ByteVector otherwise) { return mask.value != 0 ? whenSet : otherwise; }
+		inline ByteVector equal(ByteVector a, ByteVector b) { return { static_cast<Byte>(a.value == b.value ? 0xFF : 0x00) }; }
+		inline ByteVector minimum(ByteVector a, ByteVector b) { return { std::min(a.value, b.value) }; }
+		inline ByteVector shiftRight(ByteVector a, int count) { return { static_cast<Byte>(a.value >> count) }; }
+#endif
+
+		inline ByteVector operator~(ByteVector a)
+		{
+			return a ^ ByteVector::broadcast(0xFF);
+		}
+
+		// unsigned a > b
+		inline ByteVector greater(ByteVector a, ByteVector b)
+		{
+			return ~equal(minimum(a, b), a);
+		}
+
+		// the 16 bit shifts above leak bits of the neighbouring byte, keep only those of the lane itself
+		inline ByteVector shiftRightBytes(ByteVector a, int count)
+		{
+			return shiftRight(a, count) & ByteVector::broadcast(static_cast<Byte>(0xFF >> count));
+		}
+
+		// 0x01 in the lanes where the mask is set
+		inline ByteVector toFlag(ByteVector mask)
+		{
+			return mask & ByteVector::broadcast(0x01);
+		}
+	}
+
+	LockstepEngine::LockstepEngine(size_t laneCount) :
+		_laneCount(laneCount),
+		// whole AVX2 vectors, independent of what this build actually uses
+		_stride((laneCount + 31) / 32 * 32),
+		_registers(REGISTER_COUNT * _stride),
+		_stack(STACK_SIZE * _stride),
+		_programCounter(_stride),
+		_addressRegister(_stride),
+		_stackPointer(_stride),
+		_delayTimer(_stride),
+		_soundTimer(_stride),
+		_keys(_stride),
+		_memory(_laneCount * Memory::MEMORY_SIZE),
+		_framebuffers(_laneCount),
+		_randomEngines(_laneCount),
+		_faults(_laneCount),
+		_remaining(_stride),
+		_mask(_stride),
+		_condition(_stride),
+		_steps(0),
+		_laneInstructions(0)
+	{
+		static_assert(32 % ByteVector::WIDTH == 0, "lanes are padded to whole vectors");
+		assert(laneCount > 0);
+
+		load({});
+	}
+
+	bool LockstepEngine::load(const std::vector<Byte>& rom)
+	{
+		if (rom.size() > Memory::MAX_ROM_SIZE)
+		{
+			return false;
+		}
+
+		// the font and the ROM are placed by Memory, so every lane starts out with the same image as a single machine
+		Memory image;
+		image = rom;
+
+		for (size_t offset = 0; offset < Memory::MEMORY_SIZE; ++offset)
+		{
+			_memory[offset] = image.readByte(offset);
+		}
+
+		for (size_t lane = 1; lane < _laneCount; ++lane)
+		{
+			std::memcpy(&_memory[lane * Memory::MEMORY_SIZE], _memory.data(), Memory::MEMORY_SIZE);
+		}
+
+		_divergentMemory.reset();
+
+		std::fill(_registers.begin(), _registers.end(), 0x00);
+		std::fill(_stack.begin(), _stack.end(), 0x0000);
+		std::fill(_programCounter.begin(), _programCounter.end(), static_cast<Word>(Memory::ROM_START));
+		std::fill(_addressRegister.begin(), _addressRegister.end(), 0x0000);
+		std::fill(_stackPointer.begin(), _stackPointer.end(), 0x00);
+		std::fill(_delayTimer.begin(), _delayTimer.end(), 0x00);
+		std::fill(_soundTimer.begin(), _soundTimer.end(), 0x00);
+		std::fill(_keys.begin(), _keys.end(), 0x0000);
+		std::fill(_faults.begin(), _faults.end(), Fault::None);
+
+		for (auto& framebuffer : _framebuffers)
+		{
+			framebuffer.fill(0x00);
+		}
+
+		_steps = 0;
+		_laneInstructions = 0;
+
+		return true;
+	}
+
+	size_t LockstepEngine::getLaneCount() const
+	{
+		return _laneCount;
+	}
+
+	void LockstepEngine::seed(size_t lane, uint32_t seed)
+	{
+		assert(lane < _laneCount);
+		_randomEngines[lane].setState(seed);
+	}
+
+	void LockstepEngine::setKey(size_t lane, Byte key, bool isPressed)
+	{
+		assert(lane < _laneCount && key < KEY_COUNT);
+
+		const auto bit = static_cast<uint16_t>(1u << key);
+		_keys[lane] = isPressed ? (_keys[lane] | bit) : (_keys[lane] & ~bit);
+	}
+
+	void LockstepEngine::run(size_t count)
+	{
+		assert(count <= UINT32_MAX);
+		std::fill(_remaining.begin(), _remaining.begin() + _laneCount, static_cast<uint32_t>(count));
+
+		while (true)
+		{
+			Word programCounter = 0;
+			Word opcode = 0;
+
+			if (!_selectLanes(programCounter, opcode))
+			{
+				break;
+			}
+
+			_execute(opcode, programCounter);
+
+			size_t activeLanes = 0;
+			for (size_t lane = 0; lane < _laneCount; ++lane)
+			{
+				const uint32_t isActive = _mask[lane] & 1;
+				_remaining[lane] -= isActive;
+				activeLanes += isActive;
+			}
+
+			++_steps;
+			_laneInstructions += activeLanes;
+		}
+	}
+
+	void LockstepEngine::tickTimers()
+	{
+		const auto one = ByteVector::broadcast(0x01);
+		const auto zero = ByteVector::broadcast(0x00);
+
+		for (size_t i = 0; i < _stride; i += ByteVector::WIDTH)
+		{
+			for (auto* timer : { _delayTimer.data(), _soundTimer.data() })
+			{
+				const auto value = ByteVector::load(timer + i);
+				select(equal(value, zero), value, value - one).store(timer + i);
+			}
+		}
+	}
+
+	void LockstepEngine::runFrames(size_t frames, size_t instructionsPerFrame)
+	{
+		for (size_t frame = 0; frame < frames; ++frame)
+		{
+			run(instructionsPerFrame);
+			tickTimers();
+		}
+	}
+
+	Word LockstepEngine::getProgramCounter(size_t lane) const
+	{
+		assert(lane < _laneCount);
+		return _programCounter[lane];
+	}
+
+	Byte LockstepEngine::getRegisterValue(size_t lane, size_t index) const
+	{
+		assert(lane < _laneCount && index < REGISTER_COUNT);
+		return _registers[index * _stride + lane];
+	}
+
+	Word LockstepEngine::getAddressRegister(size_t lane) const
+	{
+		assert(lane < _laneCount);
+		return _addressRegister[lane];
+	}
+
+	Word LockstepEngine::getStackPointer(size_t lane) const
+	{
+		assert(lane < _laneCount);
+		return _stackPointer[lane];
+	}
+
+	Byte LockstepEngine::getDelayTimer(size_t lane) const
+	{
+		assert(lane < _laneCount);
+		return _delayTimer[lane];
+	}
+
+	Byte LockstepEngine::getSoundTimer(size_t lane) const
+	{
+		assert(lane < _laneCount);
+		return _soundTimer[lane];
+	}
+
+	Byte LockstepEngine::readByte(size_t lane, size_t offset) const
+	{
+		assert(lane < _laneCount && offset < Memory::MEMORY_SIZE);
+		return _memory[lane * Memory::MEMORY_SIZE + offset];
+	}
+
+	const FrameBuffer& LockstepEngine::getFrameBuffer(size_t lane) const
+	{
+		assert(lane < _laneCount);
+		return _framebuffers[lane];
+	}
+
+	Fault LockstepEngine::getFault(size_t lane) const
+	{
+		assert(lane < _laneCount);
+
+		if (_faults[lane] == Fault::None && _programCounter[lane] > Memory::MEMORY_SIZE - 2)
+		{
+			return Fault::ProgramCounter;
+		}
+
+		return _faults[lane];
+	}
+
+	uint64_t LockstepEngine::getSteps() const
+	{
+		return _steps;
+	}
+
+	uint64_t LockstepEngine::getLaneInstructions() const
+	{
+		return _laneInstructions;
+	}
+
+	Byte* LockstepEngine::_register(size_t index)
+	{
+		return &_registers[index * _stride];
+	}
+
+	Word LockstepEngine::_readWord(size_t lane, size_t offset) const
+	{
+		assert(offset + 1 < Memory::MEMORY_SIZE);
+
+		const Byte* memory = &_memory[lane * Memory::MEMORY_SIZE];
+		return static_cast<Word>(memory[offset] << 8 | memory[offset + 1]);
+	}
+
+	void LockstepEngine::_writeByte(size_t lane, size_t offset, Byte value)
+	{
+		assert(offset < Memory::MEMORY_SIZE);
+
+		_memory[lane * Memory::MEMORY_SIZE + offset] = value;
+		_divergentMemory.set(offset);
+	}
+
+	bool LockstepEngine::_selectLanes(Word& programCounter, Word& opcode)
+	{
+		// the lane furthest behind leads, so lanes that were masked out catch up first
+		size_t leader = 0;
+		uint32_t maxRemaining = 0;
+
+		for (size_t lane = 0; lane < _laneCount; ++lane)
+		{
+			// a lane whose program counter left memory or that faulted halts like IS does
+			if (_faults[lane] != Fault::None || _programCounter[lane] > Memory::MEMORY_SIZE - 2)
+			{
+				_remaining[lane] = 0;
+			}
+
+			if (_remaining[lane] > maxRemaining)
+			{
+				maxRemaining = _remaining[lane];
+				leader = lane;
+			}
+		}
+
+		if (maxRemaining == 0)
+		{
+			return false;
+		}
+
+		programCounter = _programCounter[leader];
+		opcode = _readWord(leader, programCounter);
+
+		// opcodes only need to be compared where stores may have made the lanes' memory differ
+		const bool isDivergent = _divergentMemory[programCounter] || _divergentMemory[programCounter + 1];
+
+		for (size_t lane = 0; lane < _stride; ++lane)
+		{
+			const bool isActive = _remaining[lane] != 0
+				&& _programCounter[lane] == programCounter
+				&& (!isDivergent || _readWord(lane, programCounter) == opcode);
+
+			_mask[lane] = isActive ? 0xFF : 0x00;
+		}
+
+		return true;
+	}
+
+	template<typename Function>
+	void LockstepEngine::_forEachLane(Function function)
+	{
+		for (size_t lane = 0; lane < _laneCount; ++lane)
+		{
+			if (_mask[lane] != 0)
+			{
+				function(lane);
+			}
+		}
+	}
+
+	void LockstepEngine::_haltFaultingLanes(const Instruction& instruction)
+	{
+		// bytes accessed from the address register on, the same checks as in IS
+		size_t length = 0;
+
+		switch (instruction.operation)
+		{
+		case Operation::Draw:
+			length = instruction.n;
+			break;
+		case Operation::StoreBCD:
+			length = 3;
+			break;
+		case Operation::StoreRegisters:
+		case Operation::LoadRegisters:
+			length = static_cast<size_t>(instruction.x) + 1;
+			break;
+		case Operation::Call:
+		case Operation::Return:
+			break;
+		default:
+			return;
+		}
+
+		_forEachLane([&](size_t lane)
+		{
+			Fault fault = Fault::None;
+
+			if (instruction.operation == Operation::Call && _stackPointer[lane] >= STACK_SIZE - 1)
+			{
+				fault = Fault::StackOverflow;
+			}
+			else if (instruction.operation == Operation::Return && _stackPointer[lane] == 0)
+			{
+				fault = Fault::StackUnderflow;
+			}
+			else if (static_cast<size_t>(_addressRegister[lane]) + length > Memory::MEMORY_SIZE)
+			{
+				fault = Fault::AddressRegister;
+			}
+
+			if (fault != Fault::None)
+			{
+				_faults[lane] = fault;
+				_remaining[lane] = 0;
+				_mask[lane] = 0x00;
+			}
+		});
+	}
+
+	void LockstepEngine::_stepProgramCounters(Word programCounter)
+	{
+		const auto next = static_cast<Word>(programCounter + 2);
+		for (size_t lane = 0; lane < _stride; ++lane)
+		{
+			_programCounter[lane] = _mask[lane] != 0 ? next : _programCounter[lane];
+		}
+	}
+
+	void LockstepEngine::_skipIf(Word programCounter)
+	{
+		for (size_t lane = 0; lane < _stride; ++lane)
+		{
+			const auto next = static_cast<Word>(programCounter + 2 + (_condition[lane] & 2));
+			_programCounter[lane] = _mask[lane] != 0 ? next : _programCounter[lane];
+		}
+	}
+
+	void LockstepEngine::_execute(Word opcode, Word programCounter)
+	{
+		const auto instruction = decodeInstruction(opcode);
+		_haltFaultingLanes(instruction);
+
+		Byte* const vx = _register(instruction.x);
+		Byte* const vy = _register(instruction.y);
+		Byte* const vf = _register(0xF);
+		const Byte* const mask = _mask.data();
+
+		const auto one = ByteVector::broadcast(0x01);
+
+		// target = compute(i) in the active lanes, one full pass per call so the steps keep the order of IS
+		auto assign = [this, mask](Byte* target, auto compute)
+		{
+			for (size_t i = 0; i < _stride; i += ByteVector::WIDTH)
+			{
+				const auto value = compute(i);
+				select(ByteVector::load(mask + i), value, ByteVector::load(target + i)).store(target + i);
+			}
+		};
+
+		auto condition = [this](auto compute)
+		{
+			for (size_t i = 0; i < _stride; i += ByteVector::WIDTH)
+			{
+				compute(i).store(&_condition[i]);
+			}
+		};
+
+		auto X = [vx](size_t i) { return ByteVector::load(vx + i); };
+		auto Y = [vy](size_t i) { return ByteVector::load(vy + i); };
+
+		switch (instruction.operation)
+		{
+		case Operation::LoadImmediate:
+			assign(vx, [&](size_t) { return ByteVector::broadcast(instruction.nn); });
+			break;
+		case Operation::AddImmediate:
+			assign(vx, [&](size_t i) { return X(i) + ByteVector::broadcast(instruction.nn); });
+			break;
+		case Operation::Move:
+			assign(vx, [&](size_t i) { return Y(i); });
+			break;
+		case Operation::Or:
+			assign(vx, [&](size_t i) { return X(i) | Y(i); });
+			break;
+		case Operation::And:
+			assign(vx, [&](size_t i) { return X(i) & Y(i); });
+			break;
+		case Operation::Xor:
+			assign(vx, [&](size_t i) { return X(i) ^ Y(i); });
+			break;
+		case Operation::Add:
+			// the carry is derived from the updated VX like IS does, VY + VX > 0xFF is VY > ~VX
+			assign(vx, [&](size_t i) { return X(i) + Y(i); });
+			assign(vf, [&](size_t i) { return toFlag(greater(Y(i), ~X(i))); });
+			break;
+		case Operation::Sub:
+			assign(vx, [&](size_t i) { return X(i) - Y(i); });
+			assign(vf, [&](size_t i) { return toFlag(~greater(Y(i), X(i))); });
+			break;
+		case Operation::ShiftRight:
+			assign(vf, [&](size_t i) { return X(i) & one; });
+			assign(vx, [&](size_t i) { return shiftRightBytes(X(i), 1); });
+			break;
+		case Operation::SubReverse:
+			assign(vf, [&](size_t i) { return toFlag(~greater(X(i), Y(i))); });
+			assign(vx, [&](size_t i) { return Y(i) - X(i); });
+			break;
+		case Operation::ShiftLeft:
+			assign(vf, [&](size_t i) { return shiftRightBytes(X(i), 7); });
+			assign(vx, [&](size_t i) { return X(i) + X(i); });
+			break;
+		case Operation::LoadDelayTimer:
+			assign(vx, [&](size_t i) { return ByteVector::load(&_delayTimer[i]); });
+			break;
+		case Operation::SetDelayTimer:
+			assign(_delayTimer.data(), X);
+			break;
+		case Operation::SetSoundTimer:
+			assign(_soundTimer.data(), X);
+			break;
+		case Operation::LoadAddress:
+			_forEachLane([&](size_t lane) { _addressRegister[lane] = instruction.nnn; });
+			break;
+		case Operation::AddAddress:
+			_forEachLane([&](size_t lane) { _addressRegister[lane] += vx[lane]; });
+			break;
+		case Operation::LoadFont:
+			_forEachLane([&](size_t lane) { _addressRegister[lane] = static_cast<Word>(vx[lane] * 0x5); });
+			break;
+		case Operation::Random:
+			_forEachLane([&](size_t lane)
+			{
+				// the same value as IS::_applyRandom()
+				const auto random = static_cast<Byte>(_randomEngines[lane]() % 0xFF);
+				vx[lane] = random & instruction.nn;
+			});
+			break;
+		case Operation::LoadRegisters:
+			_forEachLane([&](size_t lane)
+			{
+				for (size_t i = 0; i <= instruction.x; ++i)
+				{
+					_registers[i * _stride + lane] = _memory[lane * Memory::MEMORY_SIZE + _addressRegister[lane] + i];
+				}
+
+				_addressRegister[lane] += static_cast<Word>(instruction.x) + 1;
+			});
+			break;
+		case Operation::StoreBCD:
+			_forEachLane([&](size_t lane)
+			{
+				const auto value = vx[lane];
+				const auto addressRegister = _addressRegister[lane];
+
+				_writeByte(lane, addressRegister, value / 100);
+				_writeByte(lane, addressRegister + 1, (value / 10) % 10);
+				_writeByte(lane, addressRegister + 2, value % 10);
+			});
+			break;
+		case Operation::StoreRegisters:
+			_forEachLane([&](size_t lane)
+			{
+				for (size_t i = 0; i <= instruction.x; ++i)
+				{
+					_writeByte(lane, _addressRegister[lane] + i, _registers[i * _stride + lane]);
+				}
+
+				_addressRegister[lane] += static_cast<Word>(instruction.x) + 1;
+			});
+			break;
+		case Operation::ClearScreen:
+			_forEachLane([&](size_t lane) { _framebuffers[lane].fill(0x00); });
+			break;
+		case Operation::Draw:
+			_forEachLane([&](size_t lane)
+			{
+				// same wrapping rotate-and-XOR as IS::_executeDraw
+				const size_t posX = vx[lane] % DISPLAY_WIDTH;
+				const size_t posY = vy[lane] % DISPLAY_HEIGHT;
+				const Byte* memory = &_memory[lane * Memory::MEMORY_SIZE];
+				auto& framebuffer = _framebuffers[lane];
+
+				FrameRow collision = 0;
+
+				for (size_t row = 0; row < instruction.n; ++row)
+				{
+					const FrameRow sprite = static_cast<FrameRow>(memory[_addressRegister[lane] + row]) << (DISPLAY_WIDTH - SPRITE_WIDTH);
+					const FrameRow spriteRow = (sprite >> posX) | (sprite << ((DISPLAY_WIDTH - posX) % DISPLAY_WIDTH));
+
+					auto& target = framebuffer[(posY + row) % DISPLAY_HEIGHT];
+					collision |= target & spriteRow;
+					target ^= spriteRow;
+				}
+
+				vf[lane] = collision != 0 ? 1 : 0;
+			});
+			break;
+		case Operation::Return:
+			_forEachLane([&](size_t lane)
+			{
+				auto& stackPointer = _stackPointer[lane];
+				_programCounter[lane] = static_cast<Word>(_stack[stackPointer * _stride + lane] + 2);
+				--stackPointer;
+			});
+			return;
+		case Operation::Jump:
+			_forEachLane([&](size_t lane) { _programCounter[lane] = instruction.nnn; });
+			return;
+		case Operation::Call:
+			_forEachLane([&](size_t lane)
+			{
+				auto& stackPointer = _stackPointer[lane];
+				++stackPointer;
+				_stack[stackPointer * _stride + lane] = programCounter;
+				_programCounter[lane] = instruction.nnn;
+			});
+			return;
+		case Operation::JumpOffset:
+			_forEachLane([&](size_t lane) { _programCounter[lane] = static_cast<Word>(instruction.nnn + _registers[lane]); });
+			return;
+		case Operation::SkipEqualImmediate:
+			condition([&](size_t i) { return equal(X(i), ByteVector::broadcast(instruction.nn)); });
+			_skipIf(programCounter);
+			return;
+		case Operation::SkipNotEqualImmediate:
+			condition([&](size_t i) { return ~equal(X(i), ByteVector::broadcast(instruction.nn)); });
+			_skipIf(programCounter);
+			return;
+		case Operation::SkipEqualRegister:
+			condition([&](size_t i) { return equal(X(i), Y(i)); });
+			_skipIf(programCounter);
+			return;
+		case Operation::SkipNotEqualRegister:
+			condition([&](size_t i) { return ~equal(X(i), Y(i)); });
+			_skipIf(programCounter);
+			return;
+		case Operation::SkipKeyPressed:
+		case Operation::SkipKeyNotPressed:
+		{
+			const bool skipIfPressed = instruction.operation == Operation::SkipKeyPressed;
+			for (size_t lane = 0; lane < _stride; ++lane)
+			{
+				const bool isPressed = ((_keys[lane] >> (vx[lane] % KEY_COUNT)) & 1) != 0;
+				_condition[lane] = isPressed == skipIfPressed ? 0xFF : 0x00;
+			}
+
+			_skipIf(programCounter);
+			return;
+		}
+		case Operation::WaitKey:
+			_forEachLane([&](size_t lane)
+			{
+				// the highest pressed key wins, like the scan in IS; without a key the lane stays on this instruction
+				if (_keys[lane] != 0)
+				{
+					Byte key = KEY_COUNT - 1;
+					while ((_keys[lane] & (1u << key)) == 0)
+					{
+						--key;
+					}
+
+					vx[lane] = key;
+					_programCounter[lane] = static_cast<Word>(programCounter + 2);
+				}
+			});
+			return;
+		default:
+			// unsupported opcodes leave the lanes untouched
+			return;
+		}
+
+		_stepProgramCounters(programCounter);
+	}
+}
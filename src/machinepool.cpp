@@ -0,0 +1,202 @@
+#include "machinepool.h"
+#include "cpu.h"
+#include "romcache.h"
+#include <algorithm>
+#include <assert.h>
+
+namespace Chip8
+{
+	Machine::Machine() :
+		programCounter(Memory::ROM_START),
+		framebuffer(),
+		keybuffer(),
+		is(programCounter, registerSet, memory, framebuffer, keybuffer)
+	{
+		registerSet.reset();
+	}
+
+	bool Machine::load(const std::vector<Byte>& rom)
+	{
+		std::shared_ptr<const ROMImage> image;
+		if (!ROMCache::instance().load(rom.data(), rom.size(), image))
+		{
+			return false;
+		}
+
+		load(*image);
+		return true;
+	}
+
+	void Machine::load(const ROMImage& image)
+	{
+		memory = image.memory;
+
+		registerSet.reset();
+		programCounter = Memory::ROM_START;
+		framebuffer.fill(0x00);
+		keybuffer.fill(false);
+		is.clearFault();
+	}
+
+	bool Machine::runFrame(size_t instructionsPerFrame, DispatchMode mode)
+	{
+		const bool hasDrawn = is.run(instructionsPerFrame, mode);
+		registerSet.tickTimers();
+
+#ifdef QCHIP8_PROFILE
+		is.getProfiler().endFrame(hasDrawn);
+#endif
+
+		return hasDrawn;
+	}
+
+	void Machine::save(Snapshot& snapshot) const
+	{
+		snapshot.programCounter = programCounter;
+		snapshot.registerSet = registerSet;
+		memory.copyTo(snapshot.memory);
+		snapshot.framebuffer = framebuffer;
+		snapshot.keys = keybuffer;
+		snapshot.randomState = is.getRandomState();
+	}
+
+	void Machine::restore(const Snapshot& snapshot)
+	{
+		programCounter = snapshot.programCounter;
+		registerSet = snapshot.registerSet;
+		memory.restore(snapshot.memory);
+		framebuffer = snapshot.framebuffer;
+		keybuffer = snapshot.keys;
+		is.setRandomState(snapshot.randomState);
+		is.clearFault();
+
+		is.markDirty(ALL_ROWS_DIRTY);
+	}
+
+	void Machine::fork(const Machine& source)
+	{
+		programCounter = source.programCounter;
+		registerSet = source.registerSet;
+		memory = source.memory;
+		framebuffer = source.framebuffer;
+		keybuffer = source.keybuffer;
+		is.setRandomState(source.is.getRandomState());
+		is.clearFault();
+
+		is.markDirty(ALL_ROWS_DIRTY);
+	}
+
+	MachinePool::MachinePool(size_t threadCount) :
+		_size(0),
+		_instructionsPerSecond(CPU::DEFAULT_INSTRUCTIONS_PER_SECOND),
+		_dispatchMode(DispatchMode::Switch),
+		_threadPool(threadCount)
+	{
+	}
+
+	bool MachinePool::create(const std::vector<Byte>& rom, MachineId& id)
+	{
+		if (rom.size() > Memory::MAX_ROM_SIZE)
+		{
+			return false;
+		}
+
+		if (_size == _arenas.size() * ARENA_SIZE)
+		{
+			_arenas.push_back(std::make_unique<Machine[]>(ARENA_SIZE));
+		}
+
+		id = _size++;
+		get(id).load(rom);
+
+		return true;
+	}
+
+	MachinePool::MachineId MachinePool::fork(MachineId source)
+	{
+		assert(source < _size);
+
+		if (_size == _arenas.size() * ARENA_SIZE)
+		{
+			_arenas.push_back(std::make_unique<Machine[]>(ARENA_SIZE));
+		}
+
+		const MachineId id = _size++;
+		get(id).fork(get(source));
+
+		return id;
+	}
+
+	size_t MachinePool::size() const
+	{
+		return _size;
+	}
+
+	Machine& MachinePool::get(MachineId id)
+	{
+		assert(id < _size);
+		return _arenas[id / ARENA_SIZE][id % ARENA_SIZE];
+	}
+
+	const Machine& MachinePool::get(MachineId id) const
+	{
+		assert(id < _size);
+		return _arenas[id / ARENA_SIZE][id % ARENA_SIZE];
+	}
+
+	void MachinePool::setTargetSpeed(size_t instructionsPerSecond)
+	{
+		_instructionsPerSecond = instructionsPerSecond;
+	}
+
+	size_t MachinePool::getTargetSpeed() const
+	{
+		return _instructionsPerSecond;
+	}
+
+	void MachinePool::setDispatchMode(DispatchMode mode)
+	{
+		_dispatchMode = mode;
+	}
+
+	DispatchMode MachinePool::getDispatchMode() const
+	{
+		return _dispatchMode;
+	}
+
+	void MachinePool::runFrames(size_t frames, size_t framesPerSlice)
+	{
+		framesPerSlice = std::max<size_t>(1, framesPerSlice);
+
+		while (frames > 0)
+		{
+			const size_t roundFrames = std::min(frames, framesPerSlice);
+
+			for (MachineId first = 0; first < _size; first += MACHINES_PER_SLICE)
+			{
+				const MachineId last = std::min(first + MACHINES_PER_SLICE, _size);
+				_threadPool.submit([this, first, last, roundFrames]()
+				{
+					_runSlice(first, last, roundFrames);
+				});
+			}
+
+			_threadPool.wait();
+			frames -= roundFrames;
+		}
+	}
+
+	void MachinePool::_runSlice(MachineId first, MachineId last, size_t frames)
+	{
+		const size_t instructionsPerFrame = std::max<size_t>(1, _instructionsPerSecond / CPU::TIMER_FREQUENCY);
+
+		for (MachineId id = first; id < last; ++id)
+		{
+			auto& machine = get(id);
+			for (size_t frame = 0; frame < frames; ++frame)
+			{
+				machine.runFrame(instructionsPerFrame, _dispatchMode);
+			}
+		}
+	}
+}
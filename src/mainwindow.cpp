@@ -2,18 +2,43 @@
 #include "./ui_mainwindow.h"
 #include <QFileDialog>
 #include <QKeyEvent>
+#include <QStandardPaths>
+#include <fstream>
+#include <sstream>
 
 MainWindow::MainWindow(QWidget* parent)
 	: QMainWindow(parent)
 	, ui(new Ui::MainWindow),
 	_emulatorThread(nullptr),
-	_emulatorWorker(nullptr)
+	_emulatorWorker(nullptr),
+	_lastFrameStatistics(),
+	_keyProfile(0),
+	_keyProfileActions(nullptr),
+	_metricsWorker(nullptr)
 {
 	ui->setupUi(this);
+	_loadKeyProfiles();
+
+	// e.g. QCHIP8_METRICS=9180 for http://127.0.0.1:9180/metrics or QCHIP8_METRICS=unix:/tmp/qchip8.sock
+	const auto metricsEndpoint = qEnvironmentVariable("QCHIP8_METRICS");
+	if (!metricsEndpoint.isEmpty() && !_metricsServer.start(metricsEndpoint.toStdString(), [this]() { return _metricsText(); }))
+	{
+		QMessageBox::warning(this, "Failure", QString("Could not serve metrics on %1.").arg(metricsEndpoint));
+	}
+
+	// frames are pulled from the emulator at roughly the display rate instead of being pushed per frame
+	_presentationTimer.setTimerType(Qt::PreciseTimer);
+	connect(&_presentationTimer, &QTimer::timeout, this, &MainWindow::onPresentFrame);
+	_presentationTimer.start(1000 / Chip8::CPU::PRESENTATION_FREQUENCY);
+
+	connect(&_statisticsTimer, &QTimer::timeout, this, &MainWindow::onUpdateStatistics);
+	_statisticsTimer.start(1000);
 }
 
 MainWindow::~MainWindow()
 {
+	_metricsServer.stop();
+
 	if (_emulatorWorker != nullptr)
 	{
 		emit stopEmulation();// _emulatorWorker->stopEmulation();
@@ -38,6 +63,13 @@ void MainWindow::keyPressEvent(QKeyEvent* event)
 		return;
 	}
 
+	// holding the rewind key steps back one frame per frame
+	if (event->key() == REWIND_KEY)
+	{
+		_emulatorWorker->setRewinding(true);
+		return;
+	}
+
 	_emulatorWorker->keyDown(event->key());
 }
 
@@ -48,6 +80,16 @@ void MainWindow::keyReleaseEvent(QKeyEvent* event)
 		return;
 	}
 
+	if (event->key() == REWIND_KEY)
+	{
+		if (!event->isAutoRepeat())
+		{
+			_emulatorWorker->setRewinding(false);
+		}
+
+		return;
+	}
+
 	_emulatorWorker->keyUp(event->key());
 }
 
@@ -69,22 +111,31 @@ void MainWindow::on_action_Load_ROM_triggered()
 	_startEmulation();
 }
 
-void MainWindow::onRefreshScreen(Chip8::FrameBuffer framebuffer)
+void MainWindow::onPresentFrame()
 {
-	_framebuffer = QImage(Chip8::DISPLAY_WIDTH, Chip8::DISPLAY_HEIGHT, QImage::Format_Mono);
-	_framebuffer.fill(Qt::black);
+	if (!_isRunning())
+	{
+		return;
+	}
+
+	// the surface keeps its size until the window is resized, so usually only the changed rows are expanded
+	const bool isRescaled = _renderer.setScale(Chip8::Renderer::fitScale(width(), height()));
+	const bool hasFrame = _emulatorWorker->acquireFrame();
 
-	for (size_t y = 0; y < Chip8::DISPLAY_HEIGHT; ++y)
+	if (!hasFrame && !isRescaled)
 	{
-		for (size_t x = 0; x < Chip8::DISPLAY_WIDTH; ++x)
-		{
-			_framebuffer.setPixel(x, y, framebuffer[(y * Chip8::DISPLAY_WIDTH) + x]);
-		}
+		return;
 	}
 
-	_framebuffer = _framebuffer.scaled(width(), height(), Qt::KeepAspectRatio);
+	const auto& frame = _emulatorWorker->getPresentedFrame();
+	if (frame.dirtyRows == 0 && !isRescaled)
+	{
+		return;
+	}
 
-	ui->lblImageBuffer->setPixmap(QPixmap::fromImage(_framebuffer));
+	_renderer.render(frame.framebuffer, frame.dirtyRows);
+
+	ui->lblImageBuffer->setPixmap(QPixmap::fromImage(_screenImage()));
 }
 
 void MainWindow::_connectSignals() const
@@ -94,11 +145,15 @@ void MainWindow::_connectSignals() const
 	connect(_emulatorThread, &QThread::finished, _emulatorWorker, &EmulatorWorker::deleteLater);
 	connect(_emulatorWorker, &EmulatorWorker::finishedEmulation, _emulatorThread, &QThread::quit);
 	connect(_emulatorWorker, &EmulatorWorker::finishedEmulation, _emulatorWorker, &EmulatorWorker::deleteLater);
-	connect(_emulatorWorker, &EmulatorWorker::refreshScreen, this, &MainWindow::onRefreshScreen);
 }
 
 void MainWindow::_startEmulation()
 {
+	// offers to save a running recording before its emulation goes away
+	ui->actionRecord_movie->setChecked(false);
+
+	_setMetricsWorker(nullptr);
+
 	if (_emulatorWorker != nullptr)
 	{
 		emit stopEmulation();
@@ -109,10 +164,30 @@ void MainWindow::_startEmulation()
 		_emulatorThread->quit();
 	}
 
-	_emulatorThread = new QThread(this);
 	_emulatorWorker = new EmulatorWorker();
 
-	_emulatorWorker->setROM(_lastFile);
+	if (!_emulatorWorker->setROM(_lastFile))
+	{
+		delete _emulatorWorker;
+		_emulatorWorker = nullptr;
+
+		ui->menu_Emulation->setEnabled(false);
+		ui->action_Start_emulation->setEnabled(false);
+		ui->actionTake_screenshot->setEnabled(false);
+		ui->actionStop_emulation->setEnabled(false);
+
+		QMessageBox::warning(this, "Failure", QString("Could not load %1, it cannot be read or does not fit into memory.").arg(_lastFile));
+		return;
+	}
+
+	_emulatorThread = new QThread(this);
+
+	_lastFrameStatistics = {};
+	_emulatorWorker->setExecutionMode(_executionMode());
+	_emulatorWorker->setTimingMode(_timingMode());
+	_emulatorWorker->setKeyMap(_keyProfiles[_keyProfile].keyMap);
+	_emulatorWorker->setRewindLength(Chip8::RewindBuffer::DEFAULT_FRAMES);
+	_setMetricsWorker(_emulatorWorker);
 	_connectSignals();
 	_emulatorWorker->moveToThread(_emulatorThread);
 
@@ -130,11 +205,75 @@ void MainWindow::_startEmulation()
 	ui->actionStop_emulation->setEnabled(true);
 }
 
+void MainWindow::_loadKeyProfiles()
+{
+	_keyProfiles = Chip8::getBuiltinKeyProfiles();
+
+	// user defined layouts are read from keymap.ini in the configuration directory and may override the built-in ones
+	const QString configFile = QStandardPaths::locate(QStandardPaths::AppConfigLocation, "keymap.ini");
+	if (!configFile.isEmpty())
+	{
+		std::ifstream stream(QFile::encodeName(configFile).toStdString());
+		size_t errorLine = 0;
+
+		if (!Chip8::loadKeyProfiles(stream, _keyProfiles, &errorLine))
+		{
+			QMessageBox::warning(this, "Failure", QString("Could not read the key profiles from %1, line %2 is invalid.").arg(configFile).arg(errorLine));
+		}
+	}
+
+	QMenu* profileMenu = ui->menu_Emulation->addMenu(tr("&Key profile"));
+	_keyProfileActions = new QActionGroup(this);
+
+	for (size_t i = 0; i < _keyProfiles.size(); ++i)
+	{
+		QAction* action = profileMenu->addAction(QString::fromStdString(_keyProfiles[i].name));
+		action->setCheckable(true);
+		action->setChecked(i == _keyProfile);
+		_keyProfileActions->addAction(action);
+
+		connect(action, &QAction::triggered, this, [this, i]()
+		{
+			_selectKeyProfile(i);
+		});
+	}
+}
+
+void MainWindow::_selectKeyProfile(size_t index)
+{
+	_keyProfile = index;
+
+	if (_isRunning())
+	{
+		_emulatorWorker->setKeyMap(_keyProfiles[_keyProfile].keyMap);
+	}
+}
+
 bool MainWindow::_isRunning() const
 {
 	return _emulatorWorker != nullptr && _emulatorWorker->isRunning();
 }
 
+QImage MainWindow::_screenImage() const
+{
+	// wraps the renderer surface without copying it
+	return QImage(reinterpret_cast<const uchar*>(_renderer.getPixels()),
+		static_cast<int>(_renderer.getWidth()),
+		static_cast<int>(_renderer.getHeight()),
+		static_cast<int>(_renderer.getStride()),
+		QImage::Format_RGB32);
+}
+
+Chip8::ExecutionMode MainWindow::_executionMode() const
+{
+	return ui->actionUnthrottled->isChecked() ? Chip8::ExecutionMode::Unthrottled : Chip8::ExecutionMode::Throttled;
+}
+
+Chip8::TimingMode MainWindow::_timingMode() const
+{
+	return ui->actionVIP_timing->isChecked() ? Chip8::TimingMode::Cycles : Chip8::TimingMode::FixedRate;
+}
+
 void MainWindow::on_action_About_triggered()
 {
 	QMessageBox::information(this,
@@ -149,6 +288,8 @@ void MainWindow::on_action_Start_emulation_triggered()
 
 void MainWindow::on_actionStop_emulation_triggered()
 {
+	ui->actionRecord_movie->setChecked(false);
+	_setMetricsWorker(nullptr);
 	emit stopEmulation();
 	ui->actionStop_emulation->setEnabled(false);
 	ui->actionTake_screenshot->setEnabled(false);
@@ -157,8 +298,8 @@ void MainWindow::on_actionStop_emulation_triggered()
 
 void MainWindow::on_actionTake_screenshot_triggered()
 {
-	// copy the current buffer
-	QImage currentBuffer = _framebuffer;
+	// copy the current surface, the renderer keeps drawing into it while the dialog is open
+	const QImage currentBuffer = _screenImage().copy();
 
 	const auto file = QFileDialog::getSaveFileName(this, "Select file", QDir::homePath(), "Image files (*.png *.jpg *.bmp)");
 	const auto result = currentBuffer.save(file);
@@ -172,3 +313,149 @@ void MainWindow::on_actionTake_screenshot_triggered()
 		QMessageBox::warning(this, "Failure", QString("Could not save to %1.").arg(file));
 	}
 }
+
+void MainWindow::on_actionUnthrottled_toggled(bool checked)
+{
+	Q_UNUSED(checked);
+
+	if (_isRunning())
+	{
+		_emulatorWorker->setExecutionMode(_executionMode());
+	}
+}
+
+void MainWindow::on_actionVIP_timing_toggled(bool checked)
+{
+	Q_UNUSED(checked);
+
+	if (_isRunning())
+	{
+		_emulatorWorker->setTimingMode(_timingMode());
+	}
+}
+
+void MainWindow::on_actionQuick_save_triggered()
+{
+	if (!_isRunning())
+	{
+		return;
+	}
+
+	_emulatorWorker->saveSnapshot(_quickSave);
+	ui->actionQuick_load->setEnabled(true);
+}
+
+void MainWindow::on_actionQuick_load_triggered()
+{
+	if (!_isRunning())
+	{
+		return;
+	}
+
+	_emulatorWorker->loadSnapshot(_quickSave);
+}
+
+void MainWindow::on_actionRecord_movie_toggled(bool checked)
+{
+	if (!_isRunning())
+	{
+		return;
+	}
+
+	// recording restarts the game, movies always start at power-on
+	if (checked)
+	{
+		_emulatorWorker->startRecording();
+		return;
+	}
+
+	Chip8::Movie movie;
+	_emulatorWorker->stopRecording(movie);
+
+	const auto file = QFileDialog::getSaveFileName(this, "Save movie", QDir::homePath(), "Movie files (*.c8m)");
+	if (file.isEmpty())
+	{
+		return;
+	}
+
+	std::ofstream stream(QFile::encodeName(file).toStdString(), std::ios::binary);
+	if (!Chip8::writeMovie(stream, movie))
+	{
+		QMessageBox::warning(this, "Failure", QString("Could not save to %1.").arg(file));
+	}
+}
+
+void MainWindow::on_actionPlay_movie_triggered()
+{
+	if (!_isRunning())
+	{
+		return;
+	}
+
+	const auto file = QFileDialog::getOpenFileName(this, "Open movie", QDir::homePath(), "Movie files (*.c8m)");
+	if (file.isEmpty())
+	{
+		return;
+	}
+
+	ui->actionRecord_movie->setChecked(false);
+
+	std::ifstream stream(QFile::encodeName(file).toStdString(), std::ios::binary);
+	Chip8::Movie movie;
+
+	if (!Chip8::readMovie(stream, movie))
+	{
+		QMessageBox::warning(this, "Failure", QString("%1 is no movie.").arg(file));
+	}
+	else if (!_emulatorWorker->startReplay(movie))
+	{
+		QMessageBox::warning(this, "Failure", "The movie was recorded with another ROM.");
+	}
+	else
+	{
+		// the movie decides the timing, the menu follows it
+		ui->actionVIP_timing->setChecked(movie.timingMode == Chip8::TimingMode::Cycles);
+	}
+}
+
+void MainWindow::onUpdateStatistics()
+{
+	if (!_isRunning())
+	{
+		return;
+	}
+
+	// the timer fires once per second, so the presented frame delta is the frame rate
+	const auto statistics = _emulatorWorker->getFrameStatistics();
+	const auto framesPerSecond = statistics.presented - _lastFrameStatistics.presented;
+	_lastFrameStatistics = statistics;
+
+	QFileInfo fileInfo(_lastFile);
+	setWindowTitle(QString("qchip8 (%1) - %2 IPS, %3 FPS, %4 frames dropped")
+		.arg(fileInfo.fileName())
+		.arg(qRound(_emulatorWorker->getInstructionsPerSecond()))
+		.arg(framesPerSecond)
+		.arg(statistics.dropped));
+}
+
+void MainWindow::_setMetricsWorker(EmulatorWorker* worker)
+{
+	std::lock_guard<std::mutex> lock(_metricsMutex);
+	_metricsWorker = worker;
+}
+
+std::string MainWindow::_metricsText()
+{
+	Chip8::RuntimeMetrics metrics {};
+	{
+		std::lock_guard<std::mutex> lock(_metricsMutex);
+		if (_metricsWorker != nullptr)
+		{
+			metrics = _metricsWorker->getMetrics();
+		}
+	}
+
+	std::ostringstream stream;
+	Chip8::writeMetrics(stream, metrics);
+	return stream.str();
+}
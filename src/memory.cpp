@@ -1,69 +1,186 @@
 #include "memory.h"
+#include <algorithm>
 #include <assert.h>
 
 namespace Chip8
 {
+	namespace
+	{
+		constexpr size_t FONTMAP_SIZE = 80;
+
+		const Memory::Page& fontContents()
+		{
+			constexpr static StaticByteArray<FONTMAP_SIZE> fontMap = {
+				0xF0, 0x90, 0x90, 0x90, 0xF0,   // 0
+				0x20, 0x60, 0x20, 0x20, 0x70,   // 1
+				0xF0, 0x10, 0xF0, 0x80, 0xF0,   // 2
+				0xF0, 0x10, 0xF0, 0x10, 0xF0,   // 3
+				0x90, 0x90, 0xF0, 0x10, 0x10,   // 4
+				0xF0, 0x80, 0xF0, 0x10, 0xF0,   // 5
+				0xF0, 0x80, 0xF0, 0x90, 0xF0,   // 6
+				0xF0, 0x10, 0x20, 0x40, 0x40,   // 7
+				0xF0, 0x90, 0xF0, 0x90, 0xF0,   // 8
+				0xF0, 0x90, 0xF0, 0x10, 0xF0,   // 9
+				0xF0, 0x90, 0xF0, 0x90, 0x90,   // A
+				0xE0, 0x90, 0xE0, 0x90, 0xE0,   // B
+				0xF0, 0x80, 0x80, 0x80, 0xF0,   // C
+				0xE0, 0x90, 0x90, 0x90, 0xE0,   // D
+				0xF0, 0x80, 0xF0, 0x80, 0xF0,   // E
+				0xF0, 0x80, 0xF0, 0x80, 0x80    // F
+			};
+
+			static_assert(FONTMAP_SIZE <= Memory::PAGE_SIZE, "the font must fit into the first page");
+
+			static const auto page = []()
+			{
+				Memory::Page page {};
+				std::copy(fontMap.begin(), fontMap.end(), page.begin());
+				return page;
+			}();
+
+			return page;
+		}
+	}
+
+	Memory::PageReference::PageReference() : PageReference(getEmptyPage())
+	{
+	}
+
+	Memory::PageReference::PageReference(const Page& contents) : _block(new Block { { 1 }, contents })
+	{
+	}
+
+	Memory::PageReference::PageReference(const PageReference& other) : _block(other._block)
+	{
+		// a new owner only needs the block to stay alive, the reference it was copied from already guarantees that
+		_block->owners.fetch_add(1, std::memory_order_relaxed);
+	}
+
+	Memory::PageReference& Memory::PageReference::operator=(const PageReference& other)
+	{
+		if (_block != other._block)
+		{
+			other._block->owners.fetch_add(1, std::memory_order_relaxed);
+			_release();
+			_block = other._block;
+		}
+
+		return *this;
+	}
+
+	Memory::PageReference::~PageReference()
+	{
+		_release();
+	}
+
+	bool Memory::PageReference::isExclusive() const
+	{
+		// pairs with the release in _release() of the owner that dropped the page last
+		return _block->owners.load(std::memory_order_acquire) == 1;
+	}
+
+	bool Memory::PageReference::isShared() const
+	{
+		return _block->owners.load(std::memory_order_relaxed) > 1;
+	}
+
+	const Memory::PageReference& Memory::PageReference::getEmptyPage()
+	{
+		static const PageReference page(Page {});
+		return page;
+	}
+
+	const Memory::PageReference& Memory::PageReference::getFontPage()
+	{
+		static const PageReference page(fontContents());
+		return page;
+	}
+
+	void Memory::PageReference::_release()
+	{
+		// release so the reads of this owner happen before the writes of whoever finds the page exclusive next
+		if (_block->owners.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			delete _block;
+		}
+	}
+
 	Memory::Memory()
 	{
 		resetMemory();
 	}
 
-	void Memory::_loadFontMap()
-	{
-		constexpr static size_t FONTMAP_SIZE = 80;
-		constexpr static StaticByteArray<FONTMAP_SIZE> fontMap = {
-			0xF0, 0x90, 0x90, 0x90, 0xF0,   // 0
-			0x20, 0x60, 0x20, 0x20, 0x70,   // 1
-			0xF0, 0x10, 0xF0, 0x80, 0xF0,   // 2
-			0xF0, 0x10, 0xF0, 0x10, 0xF0,   // 3
-			0x90, 0x90, 0xF0, 0x10, 0x10,   // 4
-			0xF0, 0x80, 0xF0, 0x10, 0xF0,   // 5
-			0xF0, 0x80, 0xF0, 0x90, 0xF0,   // 6
-			0xF0, 0x10, 0x20, 0x40, 0x40,   // 7
-			0xF0, 0x90, 0xF0, 0x90, 0xF0,   // 8
-			0xF0, 0x90, 0xF0, 0x10, 0xF0,   // 9
-			0xF0, 0x90, 0xF0, 0x90, 0x90,   // A
-			0xE0, 0x90, 0xE0, 0x90, 0xE0,   // B
-			0xF0, 0x80, 0x80, 0x80, 0xF0,   // C
-			0xE0, 0x90, 0x90, 0x90, 0xE0,   // D
-			0xF0, 0x80, 0xF0, 0x80, 0xF0,   // E
-			0xF0, 0x80, 0xF0, 0x80, 0x80    // F
-		};
-
-		for (size_t i = 0; i < FONTMAP_SIZE; ++i)
+	Memory::Memory(const Memory& other) : _pages(other._pages)
+	{
+	}
+
+	Memory& Memory::operator=(const Memory& other)
+	{
+		for (size_t i = 0; i < PAGE_COUNT; ++i)
+		{
+			if (_pages[i] != other._pages[i])
+			{
+				_pages[i] = other._pages[i];
+				_notifyObservers(i * PAGE_SIZE, PAGE_SIZE);
+			}
+		}
+
+		return *this;
+	}
+
+	Memory::Page& Memory::_writablePage(size_t index)
+	{
+		auto& page = _pages[index];
+		if (!page.isExclusive())
+		{
+			page = PageReference(*page);
+		}
+
+		return *page;
+	}
+
+	void Memory::_notifyObservers(size_t offset, size_t length)
+	{
+		for (auto* observer : _observers)
 		{
-			_memory[i] = fontMap[i];
+			observer->onMemoryWritten(offset, length);
 		}
 	}
 
 	void Memory::resetMemory()
 	{
-		_memory.fill(0x00);
-		_loadFontMap();
+		_pages[0] = PageReference::getFontPage();
+		std::fill(_pages.begin() + 1, _pages.end(), PageReference::getEmptyPage());
+		_notifyObservers(0, MEMORY_SIZE);
 	}
 
-	void Memory::writeByte(size_t offset, Byte byte)
+	void Memory::addObserver(MemoryObserver* observer)
 	{
-		assert(offset >= 0 && offset < MEMORY_SIZE);
-		_memory[offset] = byte;
+		_observers.push_back(observer);
 	}
 
-	Byte Memory::readByte(const size_t offset) const
+	void Memory::removeObserver(MemoryObserver* observer)
+	{
+		_observers.erase(std::remove(_observers.begin(), _observers.end(), observer), _observers.end());
+	}
+
+	void Memory::writeByte(size_t offset, Byte byte)
 	{
 		assert(offset >= 0 && offset < MEMORY_SIZE);
-		return _memory[offset];
+		_writablePage(offset / PAGE_SIZE)[offset % PAGE_SIZE] = byte;
+		_notifyObservers(offset, 1);
 	}
 
-	Byte& Memory::readByte(const size_t offset)
+	Byte Memory::readByte(const size_t offset) const
 	{
 		assert(offset >= 0 && offset < MEMORY_SIZE);
-		return _memory[offset];
+		return (*_pages[offset / PAGE_SIZE])[offset % PAGE_SIZE];
 	}
 
 	Word Memory::readWord(const size_t offset) const
 	{
 		assert(offset >= 0 && offset < MEMORY_SIZE&& offset + 1 < MEMORY_SIZE);
-		return _memory[offset] << 8 | _memory[offset + 1];
+		return readByte(offset) << 8 | readByte(offset + 1);
 	}
 
 	Byte Memory::operator[](const size_t offset) const
@@ -71,18 +188,70 @@ namespace Chip8
 		return readByte(offset);
 	}
 
-	Byte& Memory::operator[](const size_t offset)
+	bool Memory::load(const Byte* data, size_t size)
 	{
-		return readByte(offset);
+		if (size > MAX_ROM_SIZE)
+		{
+			return false;
+		}
+
+		// one bulk copy per page
+		for (size_t offset = 0; offset < size;)
+		{
+			const auto address = ROM_START + offset;
+			const auto length = std::min(PAGE_SIZE - address % PAGE_SIZE, size - offset);
+
+			std::copy(data + offset, data + offset + length, _writablePage(address / PAGE_SIZE).begin() + address % PAGE_SIZE);
+			offset += length;
+		}
+
+		_notifyObservers(ROM_START, size);
+
+		return true;
+	}
+
+	Memory& Memory::operator=(const std::vector<Byte>& data)
+	{
+		[[maybe_unused]] const bool isLoaded = load(data.data(), data.size());
+		assert(isLoaded);
+
+		return *this;
 	}
 
-	Memory& Memory::operator=(const QByteArray& data)
+	void Memory::copyTo(StaticByteArray<MEMORY_SIZE>& data) const
 	{
-		for (size_t i = 0; i < static_cast<size_t>(data.length()); ++i)
+		for (size_t i = 0; i < PAGE_COUNT; ++i)
 		{
-			_memory[ROM_START + i] = static_cast<Byte>(data.at(static_cast<int>(i)));
+			std::copy((*_pages[i]).begin(), (*_pages[i]).end(), data.begin() + i * PAGE_SIZE);
 		}
+	}
 
-		return *this;
+	void Memory::restore(const StaticByteArray<MEMORY_SIZE>& data)
+	{
+		for (size_t i = 0; i < PAGE_COUNT; ++i)
+		{
+			const auto source = data.begin() + i * PAGE_SIZE;
+			if (std::equal(source, source + PAGE_SIZE, (*_pages[i]).begin()))
+			{
+				continue;
+			}
+
+			// a shared page is replaced instead of being copied first
+			if (!_pages[i].isExclusive())
+			{
+				_pages[i] = PageReference(Page {});
+			}
+
+			std::copy(source, source + PAGE_SIZE, (*_pages[i]).begin());
+			_notifyObservers(i * PAGE_SIZE, PAGE_SIZE);
+		}
+	}
+
+	size_t Memory::getSharedPageCount() const
+	{
+		return static_cast<size_t>(std::count_if(_pages.begin(), _pages.end(), [](const PageReference& page)
+		{
+			return page.isShared();
+		}));
 	}
 }
@@ -0,0 +1,295 @@
+#include "metrics.h"
+#include <cstdlib>
+#include <sstream>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QCHIP8_SOCKETS
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace Chip8
+{
+	namespace
+	{
+		// the server thread checks this often whether it was stopped
+		constexpr int ACCEPT_TIMEOUT_MILLISECONDS = 100;
+		constexpr size_t MAX_REQUEST_SIZE = 4096;
+
+#ifdef MSG_NOSIGNAL
+		// a scraper hanging up early must not raise SIGPIPE
+		constexpr int SEND_FLAGS = MSG_NOSIGNAL;
+#else
+		constexpr int SEND_FLAGS = 0;
+#endif
+
+		template<typename T>
+		void writeMetric(std::ostream& stream, const char* name, const char* type, const char* help, T value)
+		{
+			stream << "# HELP " << name << " " << help << "\n"
+				<< "# TYPE " << name << " " << type << "\n"
+				<< name << " " << value << "\n";
+		}
+	}
+
+	LatencyHistogram::LatencyHistogram() : _sum(0)
+	{
+		for (auto& bucket : _buckets)
+		{
+			bucket = 0;
+		}
+	}
+
+	uint64_t LatencyHistogram::getBucketCount(size_t bucket) const
+	{
+		return _buckets[bucket].load(std::memory_order_relaxed);
+	}
+
+	uint64_t LatencyHistogram::getCount() const
+	{
+		uint64_t count = 0;
+		for (const auto& bucket : _buckets)
+		{
+			count += bucket.load(std::memory_order_relaxed);
+		}
+
+		return count;
+	}
+
+	uint64_t LatencyHistogram::getSum() const
+	{
+		return _sum.load(std::memory_order_relaxed);
+	}
+
+	void writeMetrics(std::ostream& stream, const RuntimeMetrics& metrics)
+	{
+		const auto flags = stream.flags();
+		stream.unsetf(std::ios::floatfield);
+
+		writeMetric(stream, "qchip8_running", "gauge", "Whether the emulation is running.", metrics.isRunning ? 1 : 0);
+		writeMetric(stream, "qchip8_instructions_total", "counter", "Instructions executed.", metrics.instructions);
+		writeMetric(stream, "qchip8_instructions_per_second", "gauge", "Instructions executed in the last second.", metrics.instructionsPerSecond);
+		writeMetric(stream, "qchip8_emulated_frames_total", "counter", "Frames of 1/60 s virtual time emulated.", metrics.emulatedFrames);
+		writeMetric(stream, "qchip8_frames_per_second", "gauge", "Frames emulated in the last second.", metrics.framesPerSecond);
+		writeMetric(stream, "qchip8_produced_frames_total", "counter", "Frames in which the framebuffer changed.", metrics.producedFrames);
+		writeMetric(stream, "qchip8_presented_frames_total", "counter", "Frames picked up by the display.", metrics.presentedFrames);
+		writeMetric(stream, "qchip8_dropped_frames_total", "counter", "Frames replaced before the display picked them up.", metrics.droppedFrames);
+		writeMetric(stream, "qchip8_timer_drift_seconds_total", "counter", "Wall-clock time the 60 Hz timer fell behind.", metrics.timerDrift);
+		writeMetric(stream, "qchip8_timer_resyncs_total", "counter", "Times the frame clock fell behind and was reset.", metrics.timerResyncs);
+		writeMetric(stream, "qchip8_input_queue_depth", "gauge", "Key events waiting for the emulation thread.", metrics.inputQueueDepth);
+		writeMetric(stream, "qchip8_dropped_inputs_total", "counter", "Key events lost because the input queue was full.", metrics.droppedInputs);
+
+		stream << "# HELP qchip8_input_latency_seconds Time from queueing a key event until the emulation applied it.\n"
+			<< "# TYPE qchip8_input_latency_seconds histogram\n";
+
+		uint64_t count = 0;
+		for (size_t i = 0; i < LatencyHistogram::BUCKET_COUNT; ++i)
+		{
+			count += metrics.inputLatencyBuckets[i];
+			stream << "qchip8_input_latency_seconds_bucket{le=\"" << LatencyHistogram::getBucketBound(i) / 1e9 << "\"} " << count << "\n";
+		}
+
+		count += metrics.inputLatencyBuckets[LatencyHistogram::BUCKET_COUNT];
+		stream << "qchip8_input_latency_seconds_bucket{le=\"+Inf\"} " << count << "\n"
+			<< "qchip8_input_latency_seconds_sum " << metrics.inputLatencySum / 1e9 << "\n"
+			<< "qchip8_input_latency_seconds_count " << count << "\n";
+
+		stream.flags(flags);
+	}
+
+	MetricsServer::MetricsServer() : _socket(-1), _isStarted(false)
+	{
+	}
+
+	MetricsServer::~MetricsServer()
+	{
+		stop();
+	}
+
+	bool MetricsServer::start(const std::string& endpoint, Provider provider)
+	{
+		stop();
+
+#ifdef QCHIP8_SOCKETS
+		const std::string UNIX_PREFIX = "unix:";
+		const bool isUnixSocket = endpoint.rfind(UNIX_PREFIX, 0) == 0;
+
+		if (isUnixSocket)
+		{
+			sockaddr_un address {};
+			const auto path = endpoint.substr(UNIX_PREFIX.size());
+			if (path.empty() || path.size() >= sizeof(address.sun_path))
+			{
+				return false;
+			}
+
+			address.sun_family = AF_UNIX;
+			path.copy(address.sun_path, path.size());
+
+			// a socket left behind by an earlier run would make bind() fail, other files are never removed
+			struct stat status;
+			if (::stat(path.c_str(), &status) == 0 && S_ISSOCK(status.st_mode))
+			{
+				::unlink(path.c_str());
+			}
+
+			_socket = ::socket(AF_UNIX, SOCK_STREAM, 0);
+			if (_socket >= 0 && ::bind(_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) == 0)
+			{
+				_socketPath = path;
+			}
+		}
+		else
+		{
+			char* end = nullptr;
+			const auto port = std::strtoul(endpoint.c_str(), &end, 10);
+			if (endpoint.empty() || *end != '\0' || port == 0 || port > 0xFFFF)
+			{
+				return false;
+			}
+
+			// only the loopback interface, the metrics are not meant to leave the machine
+			sockaddr_in address {};
+			address.sin_family = AF_INET;
+			address.sin_port = htons(static_cast<uint16_t>(port));
+			address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+			_socket = ::socket(AF_INET, SOCK_STREAM, 0);
+			const int reuse = 1;
+			if (_socket >= 0)
+			{
+				::setsockopt(_socket, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+				if (::bind(_socket, reinterpret_cast<const sockaddr*>(&address), sizeof(address)) != 0)
+				{
+					::close(_socket);
+					_socket = -1;
+				}
+			}
+		}
+
+		if (_socket < 0 || (isUnixSocket && _socketPath.empty()) || ::listen(_socket, SOMAXCONN) != 0)
+		{
+			stop();
+			return false;
+		}
+
+		_provider = std::move(provider);
+		_isStarted = true;
+		_thread = std::thread(&MetricsServer::_serve, this);
+
+		return true;
+#else
+		(void)endpoint;
+		(void)provider;
+		return false;
+#endif
+	}
+
+	void MetricsServer::stop()
+	{
+		_isStarted = false;
+
+		if (_thread.joinable())
+		{
+			_thread.join();
+		}
+
+#ifdef QCHIP8_SOCKETS
+		if (_socket >= 0)
+		{
+			::close(_socket);
+			_socket = -1;
+		}
+
+		if (!_socketPath.empty())
+		{
+			::unlink(_socketPath.c_str());
+			_socketPath.clear();
+		}
+#endif
+	}
+
+	bool MetricsServer::isStarted() const
+	{
+		return _isStarted;
+	}
+
+	void MetricsServer::_serve()
+	{
+#ifdef QCHIP8_SOCKETS
+		while (_isStarted)
+		{
+			pollfd descriptor { _socket, POLLIN, 0 };
+			if (::poll(&descriptor, 1, ACCEPT_TIMEOUT_MILLISECONDS) <= 0)
+			{
+				continue;
+			}
+
+			const int connection = ::accept(_socket, nullptr, nullptr);
+			if (connection >= 0)
+			{
+				_respond(connection);
+				::close(connection);
+			}
+		}
+#endif
+	}
+
+	void MetricsServer::_respond(int connection)
+	{
+#ifdef QCHIP8_SOCKETS
+		// scrapers send a short GET, read until the end of its header or give up after a while
+		std::string request;
+		char buffer[512];
+		while (request.find("\r\n\r\n") == std::string::npos && request.size() < MAX_REQUEST_SIZE)
+		{
+			pollfd descriptor { connection, POLLIN, 0 };
+			if (::poll(&descriptor, 1, 1000) <= 0)
+			{
+				return;
+			}
+
+			const auto received = ::recv(connection, buffer, sizeof(buffer), 0);
+			if (received <= 0)
+			{
+				return;
+			}
+
+			request.append(buffer, static_cast<size_t>(received));
+		}
+
+		const auto lineEnd = request.find("\r\n");
+		const auto line = request.substr(0, lineEnd);
+		const bool isMetrics = line.rfind("GET /metrics ", 0) == 0 || line.rfind("GET / ", 0) == 0;
+
+		const std::string body = isMetrics ? _provider() : "not found\n";
+
+		std::ostringstream response;
+		response << "HTTP/1.1 " << (isMetrics ? "200 OK" : "404 Not Found") << "\r\n"
+			<< "Content-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+			<< "Content-Length: " << body.size() << "\r\n"
+			<< "Connection: close\r\n\r\n"
+			<< body;
+
+		const auto text = response.str();
+		size_t sent = 0;
+		while (sent < text.size())
+		{
+			const auto written = ::send(connection, text.data() + sent, text.size() - sent, SEND_FLAGS);
+			if (written <= 0)
+			{
+				return;
+			}
+
+			sent += static_cast<size_t>(written);
+		}
+#else
+		(void)connection;
+#endif
+	}
+}
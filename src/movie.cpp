@@ -0,0 +1,155 @@
+#include "movie.h"
+#include <cstring>
+#include <utility>
+
+namespace Chip8
+{
+	namespace
+	{
+		constexpr char MOVIE_MAGIC[] = { 'Q', 'C', '8', 'M' };
+		constexpr size_t MAX_RUN_LENGTH = 0xFFFF;
+
+		template<typename T>
+		void writeLittleEndian(std::ostream& stream, T value)
+		{
+			char bytes[sizeof(T)];
+			for (size_t i = 0; i < sizeof(T); ++i)
+			{
+				bytes[i] = static_cast<char>(value >> (8 * i));
+			}
+
+			stream.write(bytes, sizeof(T));
+		}
+
+		template<typename T>
+		bool readLittleEndian(std::istream& stream, T& value)
+		{
+			char bytes[sizeof(T)];
+			if (!stream.read(bytes, sizeof(T)))
+			{
+				return false;
+			}
+
+			value = 0;
+			for (size_t i = 0; i < sizeof(T); ++i)
+			{
+				value |= static_cast<T>(static_cast<T>(static_cast<Byte>(bytes[i])) << (8 * i));
+			}
+
+			return true;
+		}
+	}
+
+	bool writeMovie(std::ostream& stream, const Movie& movie)
+	{
+		// it could not be read back
+		if (movie.frames.size() > MAX_MOVIE_FRAMES)
+		{
+			return false;
+		}
+
+		// keys are held for many frames, so runs keep a movie to a few bytes per second
+		std::vector<std::pair<KeyMask, Word>> runs;
+		for (const auto keys : movie.frames)
+		{
+			if (runs.empty() || runs.back().first != keys || runs.back().second == MAX_RUN_LENGTH)
+			{
+				runs.emplace_back(keys, 0);
+			}
+
+			++runs.back().second;
+		}
+
+		stream.write(MOVIE_MAGIC, sizeof(MOVIE_MAGIC));
+		writeLittleEndian(stream, MOVIE_VERSION);
+		writeLittleEndian(stream, Word { 0 });
+		writeLittleEndian(stream, movie.romHash);
+		writeLittleEndian(stream, movie.seed);
+		writeLittleEndian(stream, movie.instructionsPerSecond);
+		writeLittleEndian(stream, static_cast<Byte>(movie.timingMode));
+		writeLittleEndian(stream, static_cast<Byte>(movie.waitForVBlank ? 1 : 0));
+		writeLittleEndian(stream, movie.cyclesPerSecond);
+		writeLittleEndian(stream, static_cast<uint32_t>(movie.frames.size()));
+		writeLittleEndian(stream, static_cast<uint32_t>(runs.size()));
+
+		for (const auto& run : runs)
+		{
+			writeLittleEndian(stream, run.first);
+			writeLittleEndian(stream, run.second);
+		}
+
+		return static_cast<bool>(stream);
+	}
+
+	bool readMovie(std::istream& stream, Movie& movie)
+	{
+		char magic[sizeof(MOVIE_MAGIC)];
+		Word version = 0;
+		Word reserved = 0;
+		Movie read;
+		Byte timingMode = 0;
+		Byte waitForVBlank = 0;
+		uint32_t frameCount = 0;
+		uint32_t runCount = 0;
+
+		if (!stream.read(magic, sizeof(magic)) || std::memcmp(magic, MOVIE_MAGIC, sizeof(MOVIE_MAGIC)) != 0
+			|| !readLittleEndian(stream, version) || version != MOVIE_VERSION
+			|| !readLittleEndian(stream, reserved)
+			|| !readLittleEndian(stream, read.romHash)
+			|| !readLittleEndian(stream, read.seed)
+			|| !readLittleEndian(stream, read.instructionsPerSecond)
+			|| !readLittleEndian(stream, timingMode) || timingMode > static_cast<Byte>(TimingMode::Cycles)
+			|| !readLittleEndian(stream, waitForVBlank) || waitForVBlank > 1
+			|| !readLittleEndian(stream, read.cyclesPerSecond)
+			|| !readLittleEndian(stream, frameCount)
+			|| !readLittleEndian(stream, runCount))
+		{
+			return false;
+		}
+
+		if (frameCount > MAX_MOVIE_FRAMES)
+		{
+			return false;
+		}
+
+		read.timingMode = static_cast<TimingMode>(timingMode);
+		read.waitForVBlank = waitForVBlank != 0;
+
+		// the runs are only expanded once they were all read and add up to the frame count, so neither count
+		// from the file decides an allocation by itself
+		std::vector<std::pair<KeyMask, Word>> runs;
+		size_t totalLength = 0;
+
+		for (uint32_t i = 0; i < runCount; ++i)
+		{
+			KeyMask keys = 0;
+			Word length = 0;
+			if (!readLittleEndian(stream, keys) || !readLittleEndian(stream, length))
+			{
+				return false;
+			}
+
+			totalLength += length;
+			if (totalLength > frameCount)
+			{
+				return false;
+			}
+
+			runs.emplace_back(keys, length);
+		}
+
+		if (totalLength != frameCount)
+		{
+			return false;
+		}
+
+		read.frames.reserve(frameCount);
+		for (const auto& run : runs)
+		{
+			read.frames.insert(read.frames.end(), run.second, run.first);
+		}
+
+		movie = std::move(read);
+		return true;
+	}
+}
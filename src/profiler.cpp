@@ -0,0 +1,218 @@
+#include "profiler.h"
+#include <algorithm>
+#include <iomanip>
+#include <string>
+
+namespace Chip8
+{
+	namespace
+	{
+		constexpr const char* OPERATION_NAMES[OPERATION_COUNT] = {
+			"Undecoded",
+#define CHIP8_OPERATION_NAME(name) #name,
+			CHIP8_OPERATIONS(CHIP8_OPERATION_NAME)
+#undef CHIP8_OPERATION_NAME
+		};
+
+		double percentage(uint64_t count, uint64_t total)
+		{
+			return total > 0 ? 100.0 * count / total : 0.0;
+		}
+	}
+
+	Profiler::Profiler()
+	{
+		clear();
+	}
+
+	void Profiler::updateCallStack(const RegisterSet& registerSet, const Memory& memory)
+	{
+		const auto& stack = registerSet.getStack();
+		const auto depth = std::min<size_t>(registerSet.getStackPointer(), STACK_SIZE - 1);
+
+		// the stack holds the call sites, entry 0 is never used
+		size_t callPath = 0;
+		for (size_t i = 1; i <= depth; ++i)
+		{
+			const Word callSite = std::min<Word>(stack[i], Memory::MEMORY_SIZE - 2);
+			const Word opcode = memory.readWord(callSite);
+			callPath = _enterCall(callPath, (opcode & 0xF000) == 0x2000 ? opcode & 0x0FFF : callSite);
+		}
+
+		_callPath = callPath;
+	}
+
+	void Profiler::endFrame(bool hasDrawn)
+	{
+		if (!hasDrawn)
+		{
+			return;
+		}
+
+		++_drawnFrames;
+		_drawnInstructions += _instructionsSinceDraw;
+		_minInstructionsPerDraw = std::min(_minInstructionsPerDraw, _instructionsSinceDraw);
+		_maxInstructionsPerDraw = std::max(_maxInstructionsPerDraw, _instructionsSinceDraw);
+		_instructionsSinceDraw = 0;
+	}
+
+	void Profiler::clear()
+	{
+		_operationCounts.fill(0);
+		_addressCounts.fill(0);
+		_addressOperations.fill(Operation::Undecoded);
+		_callPaths.assign(1, { static_cast<Word>(Memory::ROM_START), 0, 0, {} });
+		_callPath = 0;
+		_instructionsSinceDraw = 0;
+		_drawnFrames = 0;
+		_drawnInstructions = 0;
+		_minInstructionsPerDraw = UINT64_MAX;
+		_maxInstructionsPerDraw = 0;
+	}
+
+	uint64_t Profiler::getInstructionCount() const
+	{
+		uint64_t count = 0;
+		for (const auto operationCount : _operationCounts)
+		{
+			count += operationCount;
+		}
+
+		return count;
+	}
+
+	uint64_t Profiler::getOperationCount(Operation operation) const
+	{
+		return _operationCounts[static_cast<size_t>(operation)];
+	}
+
+	uint64_t Profiler::getAddressCount(Word address) const
+	{
+		return _addressCounts[address & (Memory::MEMORY_SIZE - 1)];
+	}
+
+	uint64_t Profiler::getDrawnFrameCount() const
+	{
+		return _drawnFrames;
+	}
+
+	uint64_t Profiler::getMinInstructionsPerDraw() const
+	{
+		return _drawnFrames > 0 ? _minInstructionsPerDraw : 0;
+	}
+
+	uint64_t Profiler::getMaxInstructionsPerDraw() const
+	{
+		return _maxInstructionsPerDraw;
+	}
+
+	void Profiler::dumpFlat(std::ostream& stream, size_t addressCount) const
+	{
+		const auto flags = stream.flags();
+		const auto total = getInstructionCount();
+
+		stream << "instructions\t" << total << "\n"
+			<< "drawn frames\t" << _drawnFrames << "\n";
+
+		if (_drawnFrames > 0)
+		{
+			stream << "instructions per drawn frame\tmin " << getMinInstructionsPerDraw()
+				<< "\tmean " << _drawnInstructions / _drawnFrames
+				<< "\tmax " << _maxInstructionsPerDraw << "\n";
+		}
+
+		std::vector<size_t> operations;
+		for (size_t i = 0; i < OPERATION_COUNT; ++i)
+		{
+			if (_operationCounts[i] > 0)
+			{
+				operations.push_back(i);
+			}
+		}
+
+		std::stable_sort(operations.begin(), operations.end(), [this](size_t a, size_t b) { return _operationCounts[a] > _operationCounts[b]; });
+
+		stream << "\n%\tcount\toperation\n" << std::fixed << std::setprecision(2);
+		for (const auto operation : operations)
+		{
+			stream << percentage(_operationCounts[operation], total) << "\t" << _operationCounts[operation] << "\t" << OPERATION_NAMES[operation] << "\n";
+		}
+
+		std::vector<size_t> addresses;
+		for (size_t i = 0; i < Memory::MEMORY_SIZE; ++i)
+		{
+			if (_addressCounts[i] > 0)
+			{
+				addresses.push_back(i);
+			}
+		}
+
+		const size_t shown = std::min(addressCount, addresses.size());
+		std::partial_sort(addresses.begin(), addresses.begin() + shown, addresses.end(), [this](size_t a, size_t b)
+		{
+			return _addressCounts[a] != _addressCounts[b] ? _addressCounts[a] > _addressCounts[b] : a < b;
+		});
+
+		stream << "\n%\tcount\taddress\toperation\n";
+		for (size_t i = 0; i < shown; ++i)
+		{
+			const auto address = addresses[i];
+			stream << std::dec << percentage(_addressCounts[address], total) << "\t" << _addressCounts[address]
+				<< "\t" << std::hex << address << "\t" << OPERATION_NAMES[static_cast<size_t>(_addressOperations[address])] << "\n";
+		}
+
+		stream.flags(flags);
+	}
+
+	void Profiler::dumpFolded(std::ostream& stream) const
+	{
+		const auto flags = stream.flags();
+
+		for (size_t i = 0; i < _callPaths.size(); ++i)
+		{
+			if (_callPaths[i].instructions == 0)
+			{
+				continue;
+			}
+
+			// collect the callees from the leaf up, then write them from the root down
+			std::vector<Word> callees;
+			for (size_t callPath = i; callPath != 0; callPath = _callPaths[callPath].parent)
+			{
+				callees.push_back(_callPaths[callPath].callee);
+			}
+
+			stream << "main";
+			for (auto callee = callees.rbegin(); callee != callees.rend(); ++callee)
+			{
+				stream << ";sub_" << std::hex << *callee;
+			}
+
+			stream << " " << std::dec << _callPaths[i].instructions << "\n";
+		}
+
+		stream.flags(flags);
+	}
+
+	size_t Profiler::_enterCall(size_t caller, Word callee)
+	{
+		for (const auto child : _callPaths[caller].children)
+		{
+			if (_callPaths[child].callee == callee)
+			{
+				return child;
+			}
+		}
+
+		if (_callPaths.size() == MAX_CALL_PATHS)
+		{
+			return caller;
+		}
+
+		const size_t callPath = _callPaths.size();
+		_callPaths.push_back({ callee, caller, 0, {} });
+		_callPaths[caller].children.push_back(callPath);
+
+		return callPath;
+	}
+}
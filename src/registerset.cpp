@@ -1,4 +1,5 @@
 #include "registerset.h"
+#include <assert.h>
 
 namespace Chip8
 {
@@ -14,18 +15,36 @@ namespace Chip8
 
 	void RegisterSet::pushStack(Word value)
 	{
+		assert(_stackPointer < STACK_SIZE - 1);
 		++_stackPointer;
 		_stack[_stackPointer] = value;
 	}
 
 	Word RegisterSet::popStack()
 	{
+		assert(_stackPointer > 0);
 		const auto value = _stack[_stackPointer];
 		--_stackPointer;
 
 		return value;
 	}
 
+	Word RegisterSet::getStackPointer() const
+	{
+		return _stackPointer;
+	}
+
+	const StaticWordArray<STACK_SIZE>& RegisterSet::getStack() const
+	{
+		return _stack;
+	}
+
+	void RegisterSet::setStack(const StaticWordArray<STACK_SIZE>& stack, Word stackPointer)
+	{
+		_stack = stack;
+		_stackPointer = stackPointer;
+	}
+
 	void RegisterSet::setRegisterValue(size_t index, Byte value)
 	{
 		assert(index >= 0 && index < REGISTER_COUNT);
@@ -106,4 +125,17 @@ namespace Chip8
 	{
 		return _soundTimer;
 	}
+
+	void RegisterSet::tickTimers()
+	{
+		if (_delayTimer > 0)
+		{
+			--_delayTimer;
+		}
+
+		if (_soundTimer > 0)
+		{
+			--_soundTimer;
+		}
+	}
 }
@@ -0,0 +1,149 @@
+#include "renderer.h"
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#define QCHIP8_SSE2
+#endif
+
+namespace Chip8
+{
+	namespace
+	{
+		// fills a run of count pixels, four at a time where possible
+		inline Pixel* fillPixels(Pixel* target, size_t count, Pixel color)
+		{
+#ifdef QCHIP8_SSE2
+			const __m128i colors = _mm_set1_epi32(static_cast<int>(color));
+			for (; count >= 4; count -= 4, target += 4)
+			{
+				_mm_storeu_si128(reinterpret_cast<__m128i*>(target), colors);
+			}
+#endif
+
+			for (; count > 0; --count)
+			{
+				*target++ = color;
+			}
+
+			return target;
+		}
+	}
+
+	Renderer::Renderer(size_t scale) : _scale(0), _foreground(DEFAULT_FOREGROUND), _background(DEFAULT_BACKGROUND), _isInvalidated(true)
+	{
+		setScale(scale);
+	}
+
+	bool Renderer::setScale(size_t scale)
+	{
+		scale = std::clamp<size_t>(scale, 1, MAX_SCALE);
+		if (scale == _scale)
+		{
+			return false;
+		}
+
+		_scale = scale;
+		_surface.assign(getWidth() * getHeight(), _background);
+		_isInvalidated = true;
+
+		return true;
+	}
+
+	size_t Renderer::getScale() const
+	{
+		return _scale;
+	}
+
+	size_t Renderer::fitScale(size_t width, size_t height)
+	{
+		return std::clamp<size_t>(std::min(width / DISPLAY_WIDTH, height / DISPLAY_HEIGHT), 1, MAX_SCALE);
+	}
+
+	void Renderer::setColors(Pixel foreground, Pixel background)
+	{
+		_foreground = foreground;
+		_background = background;
+		_isInvalidated = true;
+	}
+
+	void Renderer::render(const FrameBuffer& framebuffer, DirtyRows dirtyRows)
+	{
+		if (_isInvalidated)
+		{
+			dirtyRows = ALL_ROWS_DIRTY;
+			_isInvalidated = false;
+		}
+
+		for (size_t y = 0; y < DISPLAY_HEIGHT; ++y)
+		{
+			if ((dirtyRows & (DirtyRows(1) << y)) != 0)
+			{
+				_renderRow(framebuffer[y], y);
+			}
+		}
+	}
+
+	size_t Renderer::getWidth() const
+	{
+		return DISPLAY_WIDTH * _scale;
+	}
+
+	size_t Renderer::getHeight() const
+	{
+		return DISPLAY_HEIGHT * _scale;
+	}
+
+	size_t Renderer::getStride() const
+	{
+		return getWidth() * sizeof(Pixel);
+	}
+
+	const Pixel* Renderer::getPixels() const
+	{
+		return _surface.data();
+	}
+
+	void Renderer::writeImage(std::ostream& stream) const
+	{
+		stream << "P6\n" << getWidth() << ' ' << getHeight() << "\n255\n";
+
+		std::vector<char> line(getWidth() * 3);
+		for (size_t y = 0; y < getHeight(); ++y)
+		{
+			const Pixel* pixels = &_surface[y * getWidth()];
+			for (size_t x = 0; x < getWidth(); ++x)
+			{
+				line[x * 3] = static_cast<char>(pixels[x] >> 16);
+				line[x * 3 + 1] = static_cast<char>(pixels[x] >> 8);
+				line[x * 3 + 2] = static_cast<char>(pixels[x]);
+			}
+
+			stream.write(line.data(), static_cast<std::streamsize>(line.size()));
+		}
+	}
+
+	void Renderer::_renderRow(FrameRow row, size_t y)
+	{
+		const size_t width = getWidth();
+		Pixel* const first = &_surface[y * _scale * width];
+		Pixel* target = first;
+
+		// expand the first surface line pixel run by pixel run, the most significant bit is the leftmost pixel
+		for (size_t x = 0; x < DISPLAY_WIDTH; ++x)
+		{
+			const bool isSet = ((row >> (DISPLAY_WIDTH - 1 - x)) & 1) != 0;
+			target = fillPixels(target, _scale, isSet ? _foreground : _background);
+		}
+
+		assert(target == first + width);
+
+		// the remaining lines of the row are identical copies
+		for (size_t line = 1; line < _scale; ++line)
+		{
+			std::memcpy(first + line * width, first, width * sizeof(Pixel));
+		}
+	}
+}
@@ -0,0 +1,247 @@
+#include "rewindbuffer.h"
+#include <algorithm>
+#include <assert.h>
+#include <cstring>
+
+namespace Chip8
+{
+	namespace
+	{
+		// shorter runs of unchanged bytes are stored as part of the surrounding literal
+		constexpr size_t MIN_UNCHANGED_RUN = 4;
+		// a run length and a literal length of at most two bytes each per run, which the unchanged run before it pays for
+		constexpr size_t MAX_DELTA_SIZE = SNAPSHOT_SIZE + 2 * MIN_UNCHANGED_RUN;
+
+		static_assert(SNAPSHOT_SIZE < (1 << 14), "run lengths must fit into two bytes");
+
+		Byte* putVarint(Byte* output, size_t value)
+		{
+			while (value >= 0x80)
+			{
+				*output++ = static_cast<Byte>(value | 0x80);
+				value >>= 7;
+			}
+
+			*output++ = static_cast<Byte>(value);
+			return output;
+		}
+
+		const Byte* getVarint(const Byte* input, size_t& value)
+		{
+			value = 0;
+			for (size_t shift = 0; ; shift += 7)
+			{
+				const auto byte = *input++;
+				value |= static_cast<size_t>(byte & 0x7F) << shift;
+
+				if ((byte & 0x80) == 0)
+				{
+					return input;
+				}
+			}
+		}
+	}
+
+	RewindBuffer::RewindBuffer(size_t frames, size_t capacity) :
+		_data(capacity),
+		_begin(0),
+		_usedBytes(0),
+		_records(frames),
+		_firstRecord(0),
+		_recordCount(0),
+		_current(SNAPSHOT_SIZE),
+		_next(SNAPSHOT_SIZE),
+		_delta(MAX_DELTA_SIZE),
+		_hasCurrent(false)
+	{
+		assert(frames > 0 && capacity > 0);
+	}
+
+	void RewindBuffer::clear()
+	{
+		_begin = 0;
+		_usedBytes = 0;
+		_firstRecord = 0;
+		_recordCount = 0;
+		_hasCurrent = false;
+	}
+
+	void RewindBuffer::push(const Snapshot& snapshot)
+	{
+		serializeSnapshot(snapshot, _next);
+
+		if (_hasCurrent)
+		{
+			const auto size = _encode();
+
+			if (size > _data.size())
+			{
+				// the older frames can no longer be reached from the new one
+				while (_recordCount > 0)
+				{
+					_dropOldest();
+				}
+			}
+			else
+			{
+				while (_recordCount == _records.size() || _usedBytes + size > _data.size())
+				{
+					_dropOldest();
+				}
+
+				const auto offset = (_begin + _usedBytes) % _data.size();
+				_copyIn(_delta.data(), offset, size);
+
+				_records[(_firstRecord + _recordCount) % _records.size()] = { offset, size };
+				++_recordCount;
+				_usedBytes += size;
+			}
+		}
+
+		_current.swap(_next);
+		_hasCurrent = true;
+	}
+
+	bool RewindBuffer::stepBack(Snapshot& snapshot)
+	{
+		if (_recordCount == 0)
+		{
+			return false;
+		}
+
+		const auto record = _records[(_firstRecord + _recordCount - 1) % _records.size()];
+		--_recordCount;
+		_usedBytes -= record.size;
+
+		_copyOut(record.offset, record.size, _delta.data());
+		_decode(record.size);
+
+		return deserializeSnapshot(_current, snapshot);
+	}
+
+	size_t RewindBuffer::size() const
+	{
+		return _recordCount;
+	}
+
+	size_t RewindBuffer::getUsedBytes() const
+	{
+		return _usedBytes;
+	}
+
+	size_t RewindBuffer::getCapacity() const
+	{
+		return _data.size();
+	}
+
+	size_t RewindBuffer::_encode()
+	{
+		// stores current XOR next, so the older state is restored by applying it to the newer one
+		const auto* current = _current.data();
+		const auto* next = _next.data();
+		auto* output = _delta.data();
+		size_t position = 0;
+
+		while (true)
+		{
+			const auto unchangedStart = position;
+
+			for (uint64_t a, b; position + sizeof(uint64_t) <= SNAPSHOT_SIZE; position += sizeof(uint64_t))
+			{
+				std::memcpy(&a, current + position, sizeof(a));
+				std::memcpy(&b, next + position, sizeof(b));
+
+				if (a != b)
+				{
+					break;
+				}
+			}
+
+			while (position < SNAPSHOT_SIZE && current[position] == next[position])
+			{
+				++position;
+			}
+
+			if (position == SNAPSHOT_SIZE)
+			{
+				break;
+			}
+
+			// the literal ends in front of the next long enough run of unchanged bytes
+			size_t literalEnd = position + 1;
+			size_t unchanged = 0;
+			for (size_t i = literalEnd; i < SNAPSHOT_SIZE && unchanged < MIN_UNCHANGED_RUN; ++i)
+			{
+				if (current[i] == next[i])
+				{
+					++unchanged;
+				}
+				else
+				{
+					unchanged = 0;
+					literalEnd = i + 1;
+				}
+			}
+
+			output = putVarint(output, position - unchangedStart);
+			output = putVarint(output, literalEnd - position);
+
+			for (; position < literalEnd; ++position)
+			{
+				*output++ = current[position] ^ next[position];
+			}
+		}
+
+		const auto size = static_cast<size_t>(output - _delta.data());
+		assert(size <= MAX_DELTA_SIZE);
+
+		return size;
+	}
+
+	void RewindBuffer::_decode(size_t size)
+	{
+		const auto* input = _delta.data();
+		const auto* end = input + size;
+		auto* current = _current.data();
+
+		while (input < end)
+		{
+			size_t unchanged = 0;
+			size_t literal = 0;
+			input = getVarint(input, unchanged);
+			input = getVarint(input, literal);
+
+			current += unchanged;
+			for (size_t i = 0; i < literal; ++i)
+			{
+				*current++ ^= *input++;
+			}
+		}
+	}
+
+	void RewindBuffer::_dropOldest()
+	{
+		assert(_recordCount > 0);
+
+		const auto& record = _records[_firstRecord];
+		_begin = (_begin + record.size) % _data.size();
+		_usedBytes -= record.size;
+
+		_firstRecord = (_firstRecord + 1) % _records.size();
+		--_recordCount;
+	}
+
+	void RewindBuffer::_copyIn(const Byte* source, size_t offset, size_t size)
+	{
+		const auto firstPart = std::min(size, _data.size() - offset);
+		std::memcpy(_data.data() + offset, source, firstPart);
+		std::memcpy(_data.data(), source + firstPart, size - firstPart);
+	}
+
+	void RewindBuffer::_copyOut(size_t offset, size_t size, Byte* destination) const
+	{
+		const auto firstPart = std::min(size, _data.size() - offset);
+		std::memcpy(destination, _data.data() + offset, firstPart);
+		std::memcpy(destination + firstPart, _data.data(), size - firstPart);
+	}
+}
@@ -0,0 +1,193 @@
+#include "romcache.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+#define QCHIP8_MMAP
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#else
+#include <fstream>
+#include <iterator>
+#include <vector>
+#endif
+
+namespace Chip8
+{
+	namespace
+	{
+		// read-only view of a whole file, memory-mapped where supported
+		class ROMFile
+		{
+		public:
+			explicit ROMFile(const std::string& filename);
+			~ROMFile();
+
+			ROMFile(const ROMFile&) = delete;
+			ROMFile& operator=(const ROMFile&) = delete;
+
+			bool isOpen() const
+			{
+				return _isOpen;
+			}
+
+			const Byte* data() const
+			{
+				return _data;
+			}
+
+			size_t size() const
+			{
+				return _size;
+			}
+
+		private:
+			bool _isOpen;
+			const Byte* _data;
+			size_t _size;
+#ifndef QCHIP8_MMAP
+			std::vector<Byte> _buffer;
+#endif
+		};
+
+		ROMFile::ROMFile(const std::string& filename) : _isOpen(false), _data(nullptr), _size(0)
+		{
+#ifdef QCHIP8_MMAP
+			const int descriptor = ::open(filename.c_str(), O_RDONLY);
+			if (descriptor < 0)
+			{
+				return;
+			}
+
+			struct stat status;
+			if (::fstat(descriptor, &status) == 0 && S_ISREG(status.st_mode))
+			{
+				_size = static_cast<size_t>(status.st_size);
+				_isOpen = true;
+
+				// files that are too large are rejected by their size alone, empty ones cannot be mapped
+				if (_size > 0 && _size <= Memory::MAX_ROM_SIZE)
+				{
+					void* mapping = ::mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, descriptor, 0);
+					_isOpen = mapping != MAP_FAILED;
+					_data = _isOpen ? static_cast<const Byte*>(mapping) : nullptr;
+				}
+			}
+
+			::close(descriptor);
+#else
+			std::ifstream file(filename, std::ios::binary);
+			if (file.is_open())
+			{
+				_buffer.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+				_data = _buffer.data();
+				_size = _buffer.size();
+				_isOpen = true;
+			}
+#endif
+		}
+
+		ROMFile::~ROMFile()
+		{
+#ifdef QCHIP8_MMAP
+			if (_data != nullptr)
+			{
+				::munmap(const_cast<Byte*>(_data), _size);
+			}
+#endif
+		}
+
+		// 64 bit FNV-1a
+		uint64_t hashROMData(const Byte* data, size_t size)
+		{
+			uint64_t hash = 0xCBF29CE484222325;
+			for (size_t i = 0; i < size; ++i)
+			{
+				hash ^= data[i];
+				hash *= 0x100000001B3;
+			}
+
+			return hash;
+		}
+
+		bool hasROMData(const ROMImage& image, const Byte* data, size_t size)
+		{
+			if (image.size != size)
+			{
+				return false;
+			}
+
+			for (size_t i = 0; i < size; ++i)
+			{
+				if (image.memory.readByte(Memory::ROM_START + i) != data[i])
+				{
+					return false;
+				}
+			}
+
+			return true;
+		}
+	}
+
+	ROMCache& ROMCache::instance()
+	{
+		static ROMCache cache;
+		return cache;
+	}
+
+	bool ROMCache::load(const std::string& filename, std::shared_ptr<const ROMImage>& image)
+	{
+		const ROMFile file(filename);
+		if (!file.isOpen())
+		{
+			return false;
+		}
+
+		return load(file.data(), file.size(), image);
+	}
+
+	bool ROMCache::load(const Byte* data, size_t size, std::shared_ptr<const ROMImage>& image)
+	{
+		if (size > Memory::MAX_ROM_SIZE)
+		{
+			return false;
+		}
+
+		const auto hash = hashROMData(data, size);
+
+		std::lock_guard<std::mutex> lock(_mutex);
+
+		auto& cached = _images[hash];
+		if (cached && hasROMData(*cached, data, size))
+		{
+			image = cached;
+			return true;
+		}
+
+		auto created = std::make_shared<ROMImage>();
+		created->hash = hash;
+		created->size = size;
+		created->memory.load(data, size);
+
+		// on a hash collision the image that was cached first stays
+		if (!cached)
+		{
+			cached = created;
+		}
+
+		image = std::move(created);
+		return true;
+	}
+
+	size_t ROMCache::size() const
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		return _images.size();
+	}
+
+	void ROMCache::clear()
+	{
+		std::lock_guard<std::mutex> lock(_mutex);
+		_images.clear();
+	}
+}
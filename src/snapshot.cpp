@@ -0,0 +1,160 @@
+#include "snapshot.h"
+#include <cstring>
+#include <iterator>
+
+namespace Chip8
+{
+	namespace
+	{
+		constexpr Byte SNAPSHOT_MAGIC[] = { 'Q', 'C', '8', 'S' };
+
+		template<typename T>
+		Byte* putLittleEndian(Byte* data, T value)
+		{
+			for (size_t i = 0; i < sizeof(T); ++i)
+			{
+				*data++ = static_cast<Byte>(value >> (8 * i));
+			}
+
+			return data;
+		}
+
+		template<typename T>
+		const Byte* getLittleEndian(const Byte* data, T& value)
+		{
+			value = 0;
+			for (size_t i = 0; i < sizeof(T); ++i)
+			{
+				value |= static_cast<T>(static_cast<T>(*data++) << (8 * i));
+			}
+
+			return data;
+		}
+	}
+
+	void serializeSnapshot(const Snapshot& snapshot, std::vector<Byte>& data)
+	{
+		data.resize(SNAPSHOT_SIZE);
+
+		auto* cursor = data.data();
+		std::memcpy(cursor, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+		cursor += sizeof(SNAPSHOT_MAGIC);
+		cursor = putLittleEndian(cursor, SNAPSHOT_VERSION);
+		cursor = putLittleEndian(cursor, Word { 0 });
+
+		const auto& registerSet = snapshot.registerSet;
+		cursor = putLittleEndian(cursor, snapshot.programCounter);
+		cursor = putLittleEndian(cursor, registerSet.getAddressRegister());
+		cursor = putLittleEndian(cursor, registerSet.getStackPointer());
+		*cursor++ = registerSet.getDelayTimer();
+		*cursor++ = registerSet.getSoundTimer();
+
+		for (size_t i = 0; i < REGISTER_COUNT; ++i)
+		{
+			*cursor++ = registerSet.getRegisterValue(i);
+		}
+
+		for (const auto entry : registerSet.getStack())
+		{
+			cursor = putLittleEndian(cursor, entry);
+		}
+
+		cursor = putLittleEndian(cursor, getKeyMask(snapshot.keys));
+		cursor = putLittleEndian(cursor, snapshot.randomState);
+
+		std::memcpy(cursor, snapshot.memory.data(), snapshot.memory.size());
+		cursor += snapshot.memory.size();
+
+		for (const auto row : snapshot.framebuffer)
+		{
+			cursor = putLittleEndian(cursor, row);
+		}
+	}
+
+	bool deserializeSnapshot(const Byte* data, size_t size, Snapshot& snapshot)
+	{
+		if (size != SNAPSHOT_SIZE || std::memcmp(data, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) != 0)
+		{
+			return false;
+		}
+
+		Word version = 0;
+		const auto* cursor = getLittleEndian(data + sizeof(SNAPSHOT_MAGIC), version);
+		if (version != SNAPSHOT_VERSION)
+		{
+			return false;
+		}
+
+		// skip the reserved field
+		cursor += sizeof(Word);
+
+		Word programCounter = 0;
+		Word addressRegister = 0;
+		Word stackPointer = 0;
+		cursor = getLittleEndian(cursor, programCounter);
+		cursor = getLittleEndian(cursor, addressRegister);
+		cursor = getLittleEndian(cursor, stackPointer);
+
+		// both index arrays unchecked once the machine runs, a corrupt file must not get that far
+		if (stackPointer >= STACK_SIZE || programCounter > Memory::MEMORY_SIZE - 2)
+		{
+			return false;
+		}
+
+		snapshot.programCounter = programCounter;
+
+		auto& registerSet = snapshot.registerSet;
+		registerSet.setAddressRegister(addressRegister);
+		registerSet.setDelayTimer(*cursor++);
+		registerSet.setSoundTimer(*cursor++);
+
+		for (size_t i = 0; i < REGISTER_COUNT; ++i)
+		{
+			registerSet.setRegisterValue(i, *cursor++);
+		}
+
+		StaticWordArray<STACK_SIZE> stack;
+		for (auto& entry : stack)
+		{
+			cursor = getLittleEndian(cursor, entry);
+		}
+
+		registerSet.setStack(stack, stackPointer);
+
+		KeyMask keys = 0;
+		cursor = getLittleEndian(cursor, keys);
+		setKeyMask(snapshot.keys, keys);
+
+		cursor = getLittleEndian(cursor, snapshot.randomState);
+
+		std::memcpy(snapshot.memory.data(), cursor, snapshot.memory.size());
+		cursor += snapshot.memory.size();
+
+		for (auto& row : snapshot.framebuffer)
+		{
+			cursor = getLittleEndian(cursor, row);
+		}
+
+		return true;
+	}
+
+	bool deserializeSnapshot(const std::vector<Byte>& data, Snapshot& snapshot)
+	{
+		return deserializeSnapshot(data.data(), data.size(), snapshot);
+	}
+
+	bool writeSnapshot(std::ostream& stream, const Snapshot& snapshot)
+	{
+		std::vector<Byte> data;
+		serializeSnapshot(snapshot, data);
+
+		stream.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+		return static_cast<bool>(stream);
+	}
+
+	bool readSnapshot(std::istream& stream, Snapshot& snapshot)
+	{
+		const std::vector<Byte> data((std::istreambuf_iterator<char>(stream)), std::istreambuf_iterator<char>());
+		return deserializeSnapshot(data, snapshot);
+	}
+}
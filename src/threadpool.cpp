@@ -0,0 +1,150 @@
+#include "threadpool.h"
+#include <algorithm>
+#include <utility>
+
+namespace Chip8
+{
+	namespace
+	{
+		// lets submit() recognize calls made from one of the pool's own workers
+		thread_local const ThreadPool* currentPool = nullptr;
+		thread_local size_t currentWorker = 0;
+	}
+
+	ThreadPool::ThreadPool(size_t threadCount) : _pendingTasks(0), _queuedTasks(0), _nextWorker(0), _isStopping(false)
+	{
+		if (threadCount == 0)
+		{
+			threadCount = std::max(1u, std::thread::hardware_concurrency());
+		}
+
+		for (size_t i = 0; i < threadCount; ++i)
+		{
+			_workers.push_back(std::make_unique<Worker>());
+		}
+
+		for (size_t i = 0; i < threadCount; ++i)
+		{
+			_threads.emplace_back(&ThreadPool::_run, this, i);
+		}
+	}
+
+	ThreadPool::~ThreadPool()
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+			_isStopping = true;
+		}
+
+		_taskAvailable.notify_all();
+
+		for (auto& thread : _threads)
+		{
+			thread.join();
+		}
+	}
+
+	void ThreadPool::submit(Task task)
+	{
+		{
+			std::lock_guard<std::mutex> lock(_mutex);
+
+			const size_t index = currentPool == this ? currentWorker : _nextWorker++ % _workers.size();
+			auto& worker = *_workers[index];
+
+			std::lock_guard<std::mutex> workerLock(worker.mutex);
+			worker.tasks.push_back(std::move(task));
+
+			++_pendingTasks;
+			++_queuedTasks;
+		}
+
+		_taskAvailable.notify_one();
+	}
+
+	void ThreadPool::wait()
+	{
+		std::unique_lock<std::mutex> lock(_mutex);
+		_tasksFinished.wait(lock, [this]()
+		{
+			return _pendingTasks == 0;
+		});
+	}
+
+	size_t ThreadPool::getThreadCount() const
+	{
+		return _threads.size();
+	}
+
+	void ThreadPool::_run(size_t index)
+	{
+		currentPool = this;
+		currentWorker = index;
+
+		while (true)
+		{
+			Task task;
+			if (_popTask(index, task))
+			{
+				task();
+
+				std::lock_guard<std::mutex> lock(_mutex);
+				if (--_pendingTasks == 0)
+				{
+					_tasksFinished.notify_all();
+				}
+
+				continue;
+			}
+
+			std::unique_lock<std::mutex> lock(_mutex);
+			_taskAvailable.wait(lock, [this]()
+			{
+				return _isStopping || _queuedTasks > 0;
+			});
+
+			if (_isStopping && _queuedTasks == 0)
+			{
+				return;
+			}
+		}
+	}
+
+	bool ThreadPool::_popTask(size_t index, Task& task)
+	{
+		// own tasks first, newest first
+		{
+			auto& worker = *_workers[index];
+			std::lock_guard<std::mutex> lock(worker.mutex);
+
+			if (!worker.tasks.empty())
+			{
+				task = std::move(worker.tasks.back());
+				worker.tasks.pop_back();
+			}
+		}
+
+		// then steal the oldest task of another worker
+		for (size_t i = 1; !task && i < _workers.size(); ++i)
+		{
+			auto& victim = *_workers[(index + i) % _workers.size()];
+			std::lock_guard<std::mutex> lock(victim.mutex);
+
+			if (!victim.tasks.empty())
+			{
+				task = std::move(victim.tasks.front());
+				victim.tasks.pop_front();
+			}
+		}
+
+		if (!task)
+		{
+			return false;
+		}
+
+		std::lock_guard<std::mutex> lock(_mutex);
+		--_queuedTasks;
+
+		return true;
+	}
+}
@@ -0,0 +1,60 @@
+#include "trace.h"
+#include <assert.h>
+
+namespace Chip8
+{
+	TraceBuffer::TraceBuffer() : _records(), _head(0), _isEnabled(false)
+	{
+	}
+
+	void TraceBuffer::setEnabled(bool enabled)
+	{
+		_isEnabled = enabled;
+	}
+
+	bool TraceBuffer::isEnabled() const
+	{
+		return _isEnabled;
+	}
+
+	void TraceBuffer::clear()
+	{
+		_head = 0;
+	}
+
+	size_t TraceBuffer::size() const
+	{
+		return _head < TRACE_CAPACITY ? _head : TRACE_CAPACITY;
+	}
+
+	const TraceRecord& TraceBuffer::at(size_t index) const
+	{
+		assert(index < size());
+		const size_t first = _head - size();
+		return _records[(first + index) % TRACE_CAPACITY];
+	}
+
+	void TraceBuffer::dump(std::ostream& stream) const
+	{
+		const auto flags = stream.flags();
+
+		for (size_t i = 0; i < size(); ++i)
+		{
+			const auto& record = at(i);
+			const Word opcode = record.opcode;
+
+			stream << std::hex << record.programCounter << "\t" << opcode << "\t"
+				<< std::dec << ((opcode & 0x0F00) >> 8)
+				<< "\t"
+				<< ((opcode & 0x00F0) >> 4)
+				<< "\t"
+				<< std::hex << (opcode & 0x0FFF)
+				<< "\t"
+				<< (opcode & 0x00FF)
+				<< "\t"
+				<< (opcode & 0x000F) << "\n";
+		}
+
+		stream.flags(flags);
+	}
+}
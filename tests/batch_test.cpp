@@ -0,0 +1,116 @@
+// Runs qchip8-batch on well-behaved ROMs next to ROMs that fault and checks that every ROM gets its own status.
+//
+// usage: qchip8_batch_test <path to qchip8-batch>
+
+#include "tests/test.h"
+#include <cstdlib>
+#include <sstream>
+
+namespace
+{
+	using namespace Chip8;
+
+	struct Case
+	{
+		std::string name;
+		std::vector<Byte> rom;
+		// empty for ROMs that are expected to run fine
+		std::string error;
+		Word programCounter;
+	};
+
+	// the report line of a ROM file name, the batch writes one JSON object per line
+	std::string findReport(const std::string& report, const std::string& rom)
+	{
+		std::istringstream stream(report);
+		std::string line;
+		while (std::getline(stream, line))
+		{
+			if (line.find(rom + "\"") != std::string::npos)
+			{
+				return line;
+			}
+		}
+
+		return std::string();
+	}
+
+	bool contains(const std::string& text, const std::string& part)
+	{
+		return text.find(part) != std::string::npos;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	if (argc != 2)
+	{
+		std::cerr << "usage: qchip8_batch_test <path to qchip8-batch>\n";
+		return 2;
+	}
+
+	const std::vector<Case> cases = {
+		// V0 = 5, then loop at 0x202
+		{ "loop.ch8", { 0x60, 0x05, 0x12, 0x02 }, "", 0x202 },
+		// I = 0xFFF, FX55 with V0 to VF
+		{ "store_registers.ch8", { 0xAF, 0xFF, 0xF5, 0x55, 0x12, 0x04 }, "through I", 0x202 },
+		// I = 0xFFF, FX65 with V0 to VF
+		{ "load_registers.ch8", { 0xAF, 0xFF, 0xF5, 0x65, 0x12, 0x04 }, "through I", 0x202 },
+		// I = 0xFFF, FX33
+		{ "store_bcd.ch8", { 0xAF, 0xFF, 0xF0, 0x33, 0x12, 0x04 }, "through I", 0x202 },
+		// I = 0xFFF, 15 rows of sprite
+		{ "draw.ch8", { 0xAF, 0xFF, 0xDF, 0xFF }, "through I", 0x202 },
+		// calls itself until the stack is full
+		{ "recursion.ch8", { 0x22, 0x00 }, "stack overflow", 0x200 },
+		// returns without a call
+		{ "return.ch8", { 0x00, 0xEE, 0x12, 0x02 }, "stack underflow", 0x200 },
+		// the last word of memory is fetched, the jump after it is outside
+		{ "run_off.ch8", { 0x1F, 0xFE }, "program counter left memory", 0x1000 },
+	};
+
+	Test::TemporaryDirectory directory;
+	std::string command = std::string("\"") + argv[1] + "\" --frames 10 --threads 2";
+	const auto reportPath = (directory.path() / "report.json").string();
+	command += " --output \"" + reportPath + "\"";
+
+	for (const auto& testCase : cases)
+	{
+		command += " \"" + directory.write(testCase.name, testCase.rom) + "\"";
+	}
+
+	// some ROMs fail, so the batch exits with an error but still reports every ROM
+	CHECK(std::system(command.c_str()) != 0);
+
+	std::ifstream file(reportPath);
+	const std::string report((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+	for (const auto& testCase : cases)
+	{
+		const auto line = findReport(report, testCase.name);
+		std::cerr << testCase.name << ": " << line << "\n";
+
+		CHECK(!line.empty());
+		CHECK(contains(line, "\"pc\": " + std::to_string(testCase.programCounter) + ","));
+
+		if (testCase.error.empty())
+		{
+			CHECK(contains(line, "\"status\": \"ok\""));
+			CHECK(!contains(line, "\"error\""));
+		}
+		else
+		{
+			CHECK(contains(line, "\"status\": \"error\""));
+			CHECK(contains(line, testCase.error));
+		}
+	}
+
+	// the well-behaved ROM kept running next to the faulting ones
+	CHECK(contains(findReport(report, "loop.ch8"), "\"v\": [5, "));
+
+	// negative counts are rejected instead of wrapping around to a run that never ends
+	const auto loop = (directory.path() / "loop.ch8").string();
+	CHECK(std::system((std::string("\"") + argv[1] + "\" --frames -1 \"" + loop + "\"").c_str()) != 0);
+	CHECK(std::system((std::string("\"") + argv[1] + "\" --cycles -5 \"" + loop + "\"").c_str()) != 0);
+
+	return Test::finish();
+}
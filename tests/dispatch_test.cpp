@@ -0,0 +1,92 @@
+// Runs the same ROMs under every dispatch mode and checks that they all end in the same state, including ROMs
+// that rewrite their own code inside translated blocks and ROMs that fault.
+
+#include "tests/test.h"
+#include "machinepool.h"
+#include <memory>
+
+namespace
+{
+	using namespace Chip8;
+
+	constexpr size_t FRAMES = 200;
+	// frames end in the middle of blocks
+	constexpr size_t INSTRUCTIONS_PER_FRAME = 37;
+
+	const DispatchMode MODES[] = { DispatchMode::Switch, DispatchMode::Table, DispatchMode::Threaded, DispatchMode::Block };
+
+	struct TestROM
+	{
+		const char* name;
+		std::vector<Byte> code;
+	};
+
+	const std::vector<TestROM> ROMS = {
+		// FX55 patches the operand of 6200 at 0x206 in the block after the store, then the operand of 7001 at 0x202
+		// in the block the loop starts with, then the font digit of V4 is drawn at V0, V1
+		{ "self_modifying", {
+			0xA2, 0x07, 0x70, 0x01, 0xF0, 0x55, 0x62, 0x00, 0x83, 0x24, 0x84, 0x33, 0x80, 0x43, 0xA2, 0x03,
+			0xF0, 0x55, 0xF4, 0x29, 0xD0, 0x15, 0x12, 0x00 } },
+		{ "random", { 0xC0, 0xFF, 0xC1, 0x0F, 0x81, 0x04, 0xF1, 0x29, 0xD0, 0x05, 0x12, 0x00 } },
+		{ "address_fault", { 0xAF, 0xFF, 0xF5, 0x55, 0x12, 0x04 } },
+		{ "stack_overflow", { 0x22, 0x00 } },
+		{ "stack_underflow", { 0x00, 0xEE, 0x12, 0x02 } },
+		{ "program_counter_fault", { 0x1F, 0xFE } },
+	};
+
+	struct Result
+	{
+		std::vector<Byte> state;
+		Fault fault = Fault::None;
+		size_t instructions = 0;
+	};
+
+	Result run(const TestROM& rom, DispatchMode mode)
+	{
+		// machines are neither copyable nor movable
+		const auto machine = std::make_unique<Machine>();
+		CHECK(machine->load(rom.code));
+		machine->is.setRandomState(1234);
+
+		Result result;
+		for (size_t frame = 0; frame < FRAMES; ++frame)
+		{
+			machine->runFrame(INSTRUCTIONS_PER_FRAME, mode);
+			result.instructions += machine->is.getExecutedCount();
+		}
+
+		Snapshot snapshot;
+		machine->save(snapshot);
+		serializeSnapshot(snapshot, result.state);
+		result.fault = machine->is.getFault();
+
+		return result;
+	}
+}
+
+int main()
+{
+	for (const auto& rom : ROMS)
+	{
+		const auto expected = run(rom, DispatchMode::Switch);
+
+		for (const auto mode : MODES)
+		{
+			const auto result = run(rom, mode);
+
+			if (!CHECK(result.state == expected.state && result.fault == expected.fault && result.instructions == expected.instructions))
+			{
+				std::cerr << rom.name << ": dispatch mode " << static_cast<int>(mode) << " differs from switch dispatch\n";
+			}
+		}
+	}
+
+	// the self-modifying ROM kept running, the others halted
+	CHECK(run(ROMS[0], DispatchMode::Block).fault == Fault::None);
+	for (size_t i = 2; i < ROMS.size(); ++i)
+	{
+		CHECK(run(ROMS[i], DispatchMode::Block).fault != Fault::None);
+	}
+
+	return Test::finish();
+}
@@ -0,0 +1,142 @@
+// Runs the same ROMs, seeds and keys on LockstepEngine and on one Machine per lane and checks that every lane
+// ends up in the same state as its machine, including the lanes that fault.
+
+#include "tests/test.h"
+#include "lockstep.h"
+#include "machinepool.h"
+#include <memory>
+
+namespace
+{
+	using namespace Chip8;
+
+	constexpr size_t LANE_COUNT = 19;
+	constexpr size_t FRAMES = 24;
+	// not a divisor of any loop length, so frames end at different places in the loops
+	constexpr size_t INSTRUCTIONS_PER_FRAME = 37;
+
+	struct TestROM
+	{
+		const char* name;
+		std::vector<Byte> code;
+	};
+
+	const std::vector<TestROM> ROMS = {
+		// random sprites, arithmetic with carries and borrows, BCD, loads and stores, timers
+		{ "arithmetic", {
+			0x60, 0x00, 0xC1, 0x3F, 0xC2, 0x1F, 0xC3, 0x0F, 0xF3, 0x29, 0xD1, 0x25, 0x84, 0xF0, 0x74, 0x01,
+			0x85, 0x34, 0x86, 0x37, 0x87, 0x06, 0x88, 0x3E, 0xA3, 0x00, 0xF5, 0x33, 0xF2, 0x65, 0xA3, 0x10,
+			0xF8, 0x55, 0xF5, 0x15, 0xF9, 0x07, 0x12, 0x02 } },
+		// calls and returns depending on key 0
+		{ "keys", {
+			0xE0, 0x9E, 0x12, 0x08, 0x22, 0x10, 0x12, 0x00, 0x22, 0x16, 0x71, 0x01, 0x12, 0x00, 0x00, 0x00,
+			0x72, 0x01, 0x22, 0x16, 0x00, 0xEE, 0x73, 0x01, 0x00, 0xEE } },
+		// waits for any key, lanes without one never get past FX0A
+		{ "wait_key", { 0xF4, 0x0A, 0x75, 0x01, 0x12, 0x02 } },
+		// writes 6XNN with a random NN into its own code and executes it, so the lanes' code diverges
+		{ "self_modifying", {
+			0x60, 0x61, 0xC1, 0xFF, 0xA2, 0x10, 0xF1, 0x55, 0x72, 0x01, 0x12, 0x10, 0x00, 0x00, 0x00, 0x00,
+			0x00, 0x00, 0x83, 0x14, 0x12, 0x02 } },
+		// FX65 from a random address near the end of memory, and 00EE without a call on some lanes
+		{ "memory_faults", {
+			0xC0, 0x1F, 0xAF, 0xE0, 0xF0, 0x1E, 0xFF, 0x65, 0xC1, 0x07, 0x31, 0x00, 0x12, 0x00, 0x00, 0xEE } },
+		// recursion of random depth, the deeper lanes overflow the stack
+		{ "stack_faults", {
+			0xC0, 0x0F, 0x22, 0x06, 0x12, 0x00, 0x30, 0x00, 0x12, 0x0C, 0x00, 0xEE, 0x70, 0xFF, 0x22, 0x06,
+			0x00, 0xEE } },
+		// jumps to a random address near the end of memory and runs off it
+		{ "program_counter_fault", { 0xC0, 0xFF, 0xBF, 0x80 } },
+	};
+
+	uint32_t seedOf(size_t lane)
+	{
+		return static_cast<uint32_t>(lane * 7919 + 1);
+	}
+
+	bool isKeyPressed(size_t lane, Byte key)
+	{
+		return (key == 0 && lane % 3 == 0) || (key == lane % KEY_COUNT && lane % 4 == 1);
+	}
+
+	bool isSameState(const LockstepEngine& engine, size_t lane, const Machine& machine)
+	{
+		bool isSame = engine.getProgramCounter(lane) == machine.programCounter
+			&& engine.getAddressRegister(lane) == machine.registerSet.getAddressRegister()
+			&& engine.getStackPointer(lane) == machine.registerSet.getStackPointer()
+			&& engine.getDelayTimer(lane) == machine.registerSet.getDelayTimer()
+			&& engine.getSoundTimer(lane) == machine.registerSet.getSoundTimer()
+			&& engine.getFault(lane) == machine.is.getFault()
+			&& engine.getFrameBuffer(lane) == machine.framebuffer;
+
+		for (size_t i = 0; i < REGISTER_COUNT; ++i)
+		{
+			isSame = isSame && engine.getRegisterValue(lane, i) == machine.registerSet.getRegisterValue(i);
+		}
+
+		for (size_t offset = 0; offset < Memory::MEMORY_SIZE; ++offset)
+		{
+			isSame = isSame && engine.readByte(lane, offset) == machine.memory.readByte(offset);
+		}
+
+		return isSame;
+	}
+
+	void testROM(const TestROM& rom)
+	{
+		LockstepEngine engine(LANE_COUNT);
+		CHECK(engine.load(rom.code));
+
+		// machines are neither copyable nor movable
+		const auto machines = std::make_unique<Machine[]>(LANE_COUNT);
+
+		for (size_t lane = 0; lane < LANE_COUNT; ++lane)
+		{
+			auto& machine = machines[lane];
+			CHECK(machine.load(rom.code));
+
+			engine.seed(lane, seedOf(lane));
+			machine.is.setRandomState(seedOf(lane));
+
+			for (Byte key = 0; key < KEY_COUNT; ++key)
+			{
+				engine.setKey(lane, key, isKeyPressed(lane, key));
+				machine.keybuffer[key] = isKeyPressed(lane, key);
+			}
+		}
+
+		size_t faultedLanes = 0;
+
+		for (size_t frame = 0; frame < FRAMES; ++frame)
+		{
+			engine.runFrames(1, INSTRUCTIONS_PER_FRAME);
+
+			for (size_t lane = 0; lane < LANE_COUNT; ++lane)
+			{
+				machines[lane].runFrame(INSTRUCTIONS_PER_FRAME, DispatchMode::Switch);
+
+				if (!CHECK(isSameState(engine, lane, machines[lane])))
+				{
+					std::cerr << rom.name << ": lane " << lane << " differs after frame " << frame << "\n";
+					return;
+				}
+			}
+		}
+
+		for (size_t lane = 0; lane < LANE_COUNT; ++lane)
+		{
+			faultedLanes += engine.getFault(lane) != Fault::None ? 1 : 0;
+		}
+
+		std::cerr << rom.name << ": " << faultedLanes << " of " << LANE_COUNT << " lanes halted\n";
+	}
+}
+
+int main()
+{
+	for (const auto& rom : ROMS)
+	{
+		testROM(rom);
+	}
+
+	return Test::finish();
+}
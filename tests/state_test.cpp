@@ -0,0 +1,227 @@
+// Round trips of the machine state through snapshots, the rewind buffer and movies, the random numbers they rely
+// on, and CPUs without a machine.
+
+#include "tests/test.h"
+#include "cpu.h"
+#include "movie.h"
+#include "snapshot.h"
+#include <sstream>
+
+namespace
+{
+	using namespace Chip8;
+
+	// V0 += 1, V1 = random, loop
+	const std::vector<Byte> COUNTER_ROM = { 0x70, 0x01, 0xC1, 0xFF, 0x12, 0x00 };
+
+	std::vector<Byte> saveState(CPU& cpu)
+	{
+		Snapshot snapshot;
+		std::vector<Byte> data;
+
+		cpu.saveSnapshot(snapshot);
+		serializeSnapshot(snapshot, data);
+		return data;
+	}
+
+	// a snapshot written to a stream and loaded into another CPU continues exactly like the original
+	void testSnapshot(const Test::TemporaryDirectory& directory)
+	{
+		const auto rom = directory.write("snapshot.ch8", COUNTER_ROM);
+
+		CPU original;
+		original.setROM(rom);
+		CHECK(original.loadROM());
+		original.setSeed(3);
+
+		for (size_t i = 0; i < 10; ++i)
+		{
+			original.stepFrame();
+		}
+
+		Snapshot snapshot;
+		original.saveSnapshot(snapshot);
+
+		std::stringstream stream;
+		CHECK(writeSnapshot(stream, snapshot));
+		Snapshot read;
+		CHECK(readSnapshot(stream, read));
+
+		CPU copy;
+		copy.setROM(rom);
+		CHECK(copy.loadROM());
+		copy.loadSnapshot(read);
+		CHECK(saveState(copy) == saveState(original));
+
+		for (size_t i = 0; i < 10; ++i)
+		{
+			original.stepFrame();
+			copy.stepFrame();
+		}
+
+		CHECK(saveState(copy) == saveState(original));
+
+		// a stack pointer past the stack and a program counter past memory are rejected
+		std::vector<Byte> data;
+		serializeSnapshot(snapshot, data);
+
+		auto corrupt = data;
+		corrupt[SNAPSHOT_HEADER_SIZE + 4] = STACK_SIZE;
+		CHECK(!deserializeSnapshot(corrupt, read));
+
+		corrupt = data;
+		corrupt[SNAPSHOT_HEADER_SIZE] = 0xFF;
+		corrupt[SNAPSHOT_HEADER_SIZE + 1] = 0x0F;
+		CHECK(!deserializeSnapshot(corrupt, read));
+	}
+
+	// every rewound frame is the state the machine had at the end of that frame, and running on from it
+	// reproduces the frames that were rewound
+	void testRewind(const Test::TemporaryDirectory& directory)
+	{
+		constexpr size_t FRAMES = 40;
+		constexpr size_t REWOUND_FRAMES = 25;
+
+		CPU cpu;
+		cpu.setROM(directory.write("rewind.ch8", COUNTER_ROM));
+		CHECK(cpu.loadROM());
+		cpu.setSeed(5);
+		cpu.setRewindLength(FRAMES);
+
+		std::vector<std::vector<Byte>> states;
+		for (size_t i = 0; i < FRAMES; ++i)
+		{
+			cpu.stepFrame();
+			states.push_back(saveState(cpu));
+		}
+
+		for (size_t i = 1; i <= REWOUND_FRAMES; ++i)
+		{
+			CHECK(cpu.rewindFrame());
+			CHECK(saveState(cpu) == states[FRAMES - 1 - i]);
+		}
+
+		for (size_t i = FRAMES - REWOUND_FRAMES; i < FRAMES; ++i)
+		{
+			cpu.stepFrame();
+			CHECK(saveState(cpu) == states[i]);
+		}
+	}
+
+	// a ROM that fails to load leaves the CPU without a machine, stepping it must do nothing
+	void testMissingROM(const Test::TemporaryDirectory& directory)
+	{
+		CPU cpu;
+		cpu.setROM((directory.path() / "missing.ch8").string());
+		CHECK(!cpu.loadROM());
+		CHECK(!cpu.isLoaded());
+		CHECK(!cpu.step());
+		CHECK(!cpu.stepFrame());
+		CHECK(cpu.takeDirtyRows() == 0);
+		CHECK(!cpu.isHalted());
+	}
+
+	// the first CXNN byte after seeding with 1 is 48271 % 0xFF with every standard library
+	void testRandomByte(const Test::TemporaryDirectory& directory)
+	{
+		CPU cpu;
+		cpu.setROM(directory.write("random.ch8", { 0xC0, 0xFF, 0x12, 0x02 }));
+		cpu.setSeed(1);
+		CHECK(cpu.loadROM());
+		cpu.step();
+		CHECK(cpu.getRegisterSet().getRegisterValue(0) == 48271 % 0xFF);
+	}
+
+	void testMovieFormat()
+	{
+		Movie movie;
+		movie.romHash = 0x0123456789ABCDEF;
+		movie.seed = 42;
+		movie.instructionsPerSecond = 600;
+		movie.timingMode = TimingMode::Cycles;
+		movie.waitForVBlank = true;
+		movie.cyclesPerSecond = 500'000;
+		movie.frames = { 0x0000, 0x0001, 0x0001, 0x8000, 0x0000 };
+
+		std::stringstream stream;
+		CHECK(writeMovie(stream, movie));
+
+		Movie read;
+		CHECK(readMovie(stream, read));
+		CHECK(read.romHash == movie.romHash);
+		CHECK(read.seed == movie.seed);
+		CHECK(read.instructionsPerSecond == movie.instructionsPerSecond);
+		CHECK(read.timingMode == movie.timingMode);
+		CHECK(read.waitForVBlank == movie.waitForVBlank);
+		CHECK(read.cyclesPerSecond == movie.cyclesPerSecond);
+		CHECK(read.frames == movie.frames);
+
+		// a movie cut short is rejected
+		const auto bytes = stream.str();
+		std::stringstream truncated(bytes.substr(0, bytes.size() - 1));
+		CHECK(!readMovie(truncated, read));
+	}
+
+	void testMovieReplay(const Test::TemporaryDirectory& directory)
+	{
+		const auto rom = directory.write("counter.ch8", COUNTER_ROM);
+		constexpr size_t FRAMES = 30;
+
+		// recorded with cycle timing, replayed by a CPU that is set up for a fixed rate
+		CPU recorder;
+		recorder.setROM(rom);
+		CHECK(recorder.loadROM());
+		recorder.setSeed(7);
+		recorder.setTimingMode(TimingMode::Cycles);
+		recorder.setCycleTable(getCOSMACVIPCycleTable(true));
+		recorder.startRecording();
+
+		for (size_t i = 0; i < FRAMES; ++i)
+		{
+			recorder.stepFrame();
+		}
+
+		Movie movie;
+		recorder.stopRecording(movie);
+		CHECK(movie.frames.size() == FRAMES);
+		CHECK(movie.timingMode == TimingMode::Cycles);
+		CHECK(movie.waitForVBlank);
+
+		std::stringstream stream;
+		CHECK(writeMovie(stream, movie));
+		CHECK(readMovie(stream, movie));
+
+		CPU player;
+		player.setROM(rom);
+		CHECK(player.loadROM());
+		player.setTimingMode(TimingMode::FixedRate);
+		CHECK(player.startReplay(movie));
+		CHECK(player.getTimingMode() == TimingMode::Cycles);
+		CHECK(player.getCycleTable().waitForVBlank);
+
+		while (player.isReplaying())
+		{
+			player.stepFrame();
+		}
+
+		CHECK(player.getProgramCounter() == recorder.getProgramCounter());
+		for (size_t i = 0; i < REGISTER_COUNT; ++i)
+		{
+			CHECK(player.getRegisterSet().getRegisterValue(i) == recorder.getRegisterSet().getRegisterValue(i));
+		}
+	}
+}
+
+int main()
+{
+	Test::TemporaryDirectory directory;
+
+	testMissingROM(directory);
+	testRandomByte(directory);
+	testSnapshot(directory);
+	testRewind(directory);
+	testMovieFormat();
+	testMovieReplay(directory);
+
+	return Test::finish();
+}
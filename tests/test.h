@@ -0,0 +1,89 @@
+#ifndef TEST_H
+#define TEST_H
+
+// Minimal checking helpers for the test executables run by ctest. A failed check is reported with its location
+// and makes the test return a non-zero exit code, the remaining checks still run.
+
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+#include "datatypes.h"
+
+#define CHECK(condition) ::Chip8::Test::check((condition), #condition, __FILE__, __LINE__)
+
+namespace Chip8
+{
+    namespace Test
+    {
+        inline size_t& failureCount()
+        {
+            static size_t count = 0;
+            return count;
+        }
+
+        inline bool check(bool condition, const char* expression, const char* file, int line)
+        {
+            if (!condition)
+            {
+                std::cerr << file << ":" << line << ": check failed: " << expression << "\n";
+                ++failureCount();
+            }
+
+            return condition;
+        }
+
+        // exit code of the test, prints a summary if any check failed
+        inline int finish()
+        {
+            if (failureCount() > 0)
+            {
+                std::cerr << failureCount() << " check(s) failed\n";
+                return 1;
+            }
+
+            return 0;
+        }
+
+        // a fresh directory below the system temp directory, removed again when the test ends
+        class TemporaryDirectory
+        {
+        public:
+            TemporaryDirectory()
+            {
+                _path = std::filesystem::temp_directory_path() / ("qchip8_test_" + std::to_string(std::random_device{}()));
+                std::filesystem::create_directories(_path);
+            }
+
+            ~TemporaryDirectory()
+            {
+                std::error_code error;
+                std::filesystem::remove_all(_path, error);
+            }
+
+            TemporaryDirectory(const TemporaryDirectory&) = delete;
+            TemporaryDirectory& operator=(const TemporaryDirectory&) = delete;
+
+            const std::filesystem::path& path() const
+            {
+                return _path;
+            }
+
+            std::string write(const std::string& name, const std::vector<Byte>& content) const
+            {
+                const auto file = (_path / name).string();
+                std::ofstream stream(file, std::ios::binary);
+                stream.write(reinterpret_cast<const char*>(content.data()), static_cast<std::streamsize>(content.size()));
+                return file;
+            }
+
+        private:
+            std::filesystem::path _path;
+        };
+    }
+}
+
+#endif // TEST_H
@@ -0,0 +1,617 @@
+// Runs CHIP-8 ROMs headless for a fixed number of frames or instructions and reports the final machine state.
+//
+// usage: qchip8-batch [options] <rom files or directories...>
+//
+//   --frames N       run N frames of 1/60 s virtual time each (default 600)
+//   --cycles N       run N single instructions instead of frames
+//   --speed IPS      instructions per second of virtual time (default 840)
+//   --dispatch MODE  switch, table, threaded or block
+//   --timing MODE    fixed (default) runs --speed instructions per second, vip and vip-vblank charge the
+//                    approximate COSMAC VIP cost of every instruction, vip-vblank also ends the frame on DXYN
+//   --list FILE      read additional ROM paths from FILE, one per line
+//   --format FORMAT  json (default) or csv
+//   --output FILE    write the report to FILE instead of stdout
+//   --threads N      number of worker threads, 0 uses all cores (default)
+//   --rewind N       step back N frames at the end of the run, the report shows that earlier state
+//   --seed N         seed of the random number generator, random by default
+//   --replay FILE    replay a movie instead of running --frames, with its seed, speed and timing
+//   --load-states DIR  resume every ROM from the snapshot written by --save-states
+//   --save-states DIR  write a snapshot of every machine after the run
+//   --profile DIR    write a flat profile (.txt) and folded call stacks (.folded) of every ROM,
+//                    needs -DQCHIP8_ENABLE_PROFILER=ON
+//
+// Snapshots and profiles are named <index>_<rom name> after the position of the ROM in the run, so checkpointed
+// runs must be resumed with the same ROM list.
+
+#include "cpu.h"
+#include "movie.h"
+#include "snapshot.h"
+#include "threadpool.h"
+#include "tools/commandline.h"
+#include <algorithm>
+#include <cctype>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace
+{
+	using namespace Chip8;
+
+	struct Options
+	{
+		size_t frames = 600;
+		size_t cycles = 0;
+		size_t speed = CPU::DEFAULT_INSTRUCTIONS_PER_SECOND;
+		DispatchMode dispatchMode = DispatchMode::Switch;
+		TimingMode timingMode = TimingMode::FixedRate;
+		bool waitForVBlank = false;
+		std::string format = "json";
+		std::string output;
+		size_t threads = 0;
+		size_t rewind = 0;
+		bool hasSeed = false;
+		size_t seed = 0;
+		bool hasReplay = false;
+		Movie replay;
+		std::string loadStates;
+		std::string saveStates;
+		std::string profiles;
+		std::vector<std::string> roms;
+	};
+
+	struct Result
+	{
+		std::string rom;
+		bool isLoaded = false;
+		bool isSaved = true;
+		// why the ROM failed; machines that halted still report their final state
+		std::string error;
+		uint64_t instructions = 0;
+		double seconds = 0.0;
+		uint64_t framebufferHash = 0;
+		Word programCounter = 0;
+		Word addressRegister = 0;
+		Word stackPointer = 0;
+		Byte delayTimer = 0;
+		Byte soundTimer = 0;
+		StaticByteArray<REGISTER_COUNT> registers {};
+	};
+
+	// 64 bit FNV-1a over the rows, most significant byte first, so hashes are the same on every host
+	uint64_t hashFrameBuffer(const FrameBuffer& framebuffer)
+	{
+		uint64_t hash = 0xCBF29CE484222325;
+		for (const auto row : framebuffer)
+		{
+			for (int shift = 56; shift >= 0; shift -= 8)
+			{
+				hash ^= (row >> shift) & 0xFF;
+				hash *= 0x100000001B3;
+			}
+		}
+
+		return hash;
+	}
+
+	std::string outputPath(const std::string& directory, const std::string& rom, size_t index, const std::string& extension)
+	{
+		const auto name = std::to_string(index) + "_" + std::filesystem::path(rom).stem().string() + extension;
+		return (std::filesystem::path(directory) / name).string();
+	}
+
+	std::string describeFault(Fault fault, Word programCounter)
+	{
+		std::ostringstream error;
+		switch (fault)
+		{
+		case Fault::AddressRegister:
+			error << "access past the end of memory through I";
+			break;
+		case Fault::StackOverflow:
+			error << "stack overflow";
+			break;
+		case Fault::StackUnderflow:
+			error << "stack underflow";
+			break;
+		default:
+			error << "program counter left memory";
+			break;
+		}
+
+		error << " at 0x" << std::hex << programCounter;
+		return error.str();
+	}
+
+	Result runROM(const std::string& rom, size_t index, const Options& options)
+	{
+		Result result;
+		result.rom = rom;
+
+		CPU cpu;
+		cpu.setROM(rom);
+		result.isLoaded = cpu.loadROM();
+		if (!result.isLoaded)
+		{
+			result.error = "could not load ROM";
+		}
+
+		// before loading a snapshot, which brings its own random state
+		if (options.hasSeed)
+		{
+			cpu.setSeed(static_cast<uint32_t>(options.seed));
+		}
+
+		if (result.isLoaded && !options.loadStates.empty())
+		{
+			const auto path = outputPath(options.loadStates, rom, index, ".c8s");
+			std::ifstream file(path, std::ios::binary);
+			Snapshot snapshot;
+
+			result.isLoaded = readSnapshot(file, snapshot);
+			if (result.isLoaded)
+			{
+				cpu.loadSnapshot(snapshot);
+			}
+			else
+			{
+				result.error = "could not read snapshot";
+				std::cerr << "could not read snapshot " << path << "\n";
+			}
+		}
+
+		if (!result.isLoaded)
+		{
+			return result;
+		}
+
+		cpu.setTargetSpeed(options.speed);
+		cpu.setDispatchMode(options.dispatchMode);
+		cpu.setTimingMode(options.timingMode);
+		cpu.setCycleTable(getCOSMACVIPCycleTable(options.waitForVBlank));
+
+		if (options.rewind > 0)
+		{
+			cpu.setRewindLength(options.rewind);
+		}
+
+		// a replay overrides the speed and timing options with those the movie was recorded with
+		if (options.hasReplay && !cpu.startReplay(options.replay))
+		{
+			std::cerr << "the movie was not recorded with " << rom << "\n";
+			result.error = "movie was recorded with another ROM";
+			result.isLoaded = false;
+			return result;
+		}
+
+		const auto frames = options.hasReplay ? options.replay.frames.size() : options.frames;
+
+		const auto start = std::chrono::steady_clock::now();
+		const auto executedBefore = cpu.getMetrics().instructions;
+
+		if (options.cycles > 0)
+		{
+			for (size_t i = 0; i < options.cycles; ++i)
+			{
+				cpu.step();
+			}
+		}
+		else
+		{
+			for (size_t i = 0; i < frames; ++i)
+			{
+				cpu.stepFrame();
+			}
+		}
+
+		// frames by cycles run a varying number of instructions, halted machines none at all
+		result.instructions = cpu.getMetrics().instructions - executedBefore;
+
+		if (cpu.isHalted())
+		{
+			result.error = describeFault(cpu.getFault(), cpu.getProgramCounter());
+		}
+
+		// only frames are recorded, so there is nothing to rewind after --cycles
+		for (size_t i = 0; i < options.rewind; ++i)
+		{
+			if (!cpu.rewindFrame())
+			{
+				break;
+			}
+		}
+
+		result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+		if (!options.saveStates.empty())
+		{
+			const auto path = outputPath(options.saveStates, rom, index, ".c8s");
+			std::ofstream file(path, std::ios::binary);
+			Snapshot snapshot;
+
+			cpu.saveSnapshot(snapshot);
+			result.isSaved = writeSnapshot(file, snapshot);
+			if (!result.isSaved)
+			{
+				result.error = "could not write snapshot";
+				std::cerr << "could not write snapshot " << path << "\n";
+			}
+		}
+
+#ifdef QCHIP8_PROFILE
+		if (!options.profiles.empty())
+		{
+			std::ofstream flat(outputPath(options.profiles, rom, index, ".txt"));
+			std::ofstream folded(outputPath(options.profiles, rom, index, ".folded"));
+			cpu.getProfiler().dumpFlat(flat);
+			cpu.getProfiler().dumpFolded(folded);
+		}
+#endif
+
+		const auto& registerSet = cpu.getRegisterSet();
+		result.framebufferHash = hashFrameBuffer(cpu.getFrameBuffer());
+		result.programCounter = cpu.getProgramCounter();
+		result.addressRegister = registerSet.getAddressRegister();
+		result.stackPointer = registerSet.getStackPointer();
+		result.delayTimer = registerSet.getDelayTimer();
+		result.soundTimer = registerSet.getSoundTimer();
+
+		for (size_t i = 0; i < REGISTER_COUNT; ++i)
+		{
+			result.registers[i] = registerSet.getRegisterValue(i);
+		}
+
+		return result;
+	}
+
+	std::string escapeCSV(const std::string& text)
+	{
+		if (text.find_first_of(",\"\n") == std::string::npos)
+		{
+			return text;
+		}
+
+		std::string escaped = "\"";
+		for (const char c : text)
+		{
+			escaped += c;
+			if (c == '"')
+			{
+				escaped += '"';
+			}
+		}
+
+		return escaped + "\"";
+	}
+
+	std::string formatHash(uint64_t hash)
+	{
+		std::ostringstream stream;
+		stream << std::hex << std::setw(16) << std::setfill('0') << hash;
+		return stream.str();
+	}
+
+	bool isFailed(const Result& result)
+	{
+		return !result.isLoaded || !result.isSaved || !result.error.empty();
+	}
+
+	double instructionsPerSecond(const Result& result)
+	{
+		return result.seconds > 0.0 ? result.instructions / result.seconds : 0.0;
+	}
+
+	void writeJSON(std::ostream& stream, const std::vector<Result>& results)
+	{
+		stream << "[\n";
+
+		for (size_t i = 0; i < results.size(); ++i)
+		{
+			const auto& result = results[i];
+			stream << "  {\"rom\": \"" << escapeJSON(result.rom) << "\", \"status\": \"" << (isFailed(result) ? "error" : "ok") << "\"";
+
+			if (!result.error.empty())
+			{
+				stream << ", \"error\": \"" << escapeJSON(result.error) << "\"";
+			}
+
+			if (result.isLoaded)
+			{
+				stream << ", \"instructions\": " << result.instructions
+					<< ", \"seconds\": " << result.seconds
+					<< ", \"ips\": " << instructionsPerSecond(result)
+					<< ", \"framebuffer_hash\": \"" << formatHash(result.framebufferHash) << "\""
+					<< ", \"pc\": " << result.programCounter
+					<< ", \"i\": " << result.addressRegister
+					<< ", \"sp\": " << result.stackPointer
+					<< ", \"dt\": " << static_cast<int>(result.delayTimer)
+					<< ", \"st\": " << static_cast<int>(result.soundTimer)
+					<< ", \"v\": [";
+
+				for (size_t r = 0; r < REGISTER_COUNT; ++r)
+				{
+					stream << (r > 0 ? ", " : "") << static_cast<int>(result.registers[r]);
+				}
+
+				stream << "]";
+			}
+
+			stream << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+		}
+
+		stream << "]\n";
+	}
+
+	void writeCSV(std::ostream& stream, const std::vector<Result>& results)
+	{
+		stream << "rom,status,instructions,seconds,ips,framebuffer_hash,pc,i,sp,dt,st";
+		for (size_t r = 0; r < REGISTER_COUNT; ++r)
+		{
+			stream << ",v" << std::hex << r << std::dec;
+		}
+
+		// the error comes last so the state columns keep their position
+		stream << ",error\n";
+
+		for (const auto& result : results)
+		{
+			stream << escapeCSV(result.rom) << "," << (isFailed(result) ? "error" : "ok");
+
+			if (result.isLoaded)
+			{
+				stream << "," << result.instructions
+					<< "," << result.seconds
+					<< "," << instructionsPerSecond(result)
+					<< "," << formatHash(result.framebufferHash)
+					<< "," << result.programCounter
+					<< "," << result.addressRegister
+					<< "," << result.stackPointer
+					<< "," << static_cast<int>(result.delayTimer)
+					<< "," << static_cast<int>(result.soundTimer);
+
+				for (const auto value : result.registers)
+				{
+					stream << "," << static_cast<int>(value);
+				}
+			}
+			else
+			{
+				// empty state columns, the row still has the error in the last one
+				stream << std::string(9 + REGISTER_COUNT, ',');
+			}
+
+			stream << "," << escapeCSV(result.error) << "\n";
+		}
+	}
+
+	bool isROMFile(const std::filesystem::path& path)
+	{
+		auto extension = path.extension().string();
+		std::transform(extension.begin(), extension.end(), extension.begin(), [](unsigned char c)
+		{
+			return static_cast<char>(std::tolower(c));
+		});
+
+		return extension == ".ch8" || extension == ".c8" || extension == ".bin";
+	}
+
+	// directories are searched recursively, their ROMs are sorted so reports are stable across runs
+	bool collectROMs(const std::string& argument, std::vector<std::string>& roms)
+	{
+		std::error_code error;
+		if (!std::filesystem::is_directory(argument, error))
+		{
+			roms.push_back(argument);
+			return true;
+		}
+
+		std::vector<std::string> found;
+		for (const auto& entry : std::filesystem::recursive_directory_iterator(argument, error))
+		{
+			if (entry.is_regular_file() && isROMFile(entry.path()))
+			{
+				found.push_back(entry.path().string());
+			}
+		}
+
+		std::sort(found.begin(), found.end());
+		roms.insert(roms.end(), found.begin(), found.end());
+
+		return !error;
+	}
+
+	bool parseOptions(int argc, char* argv[], Options& options)
+	{
+		for (int i = 1; i < argc; ++i)
+		{
+			const std::string argument = argv[i];
+			const bool hasValue = i + 1 < argc;
+
+			if (argument.rfind("--", 0) != 0)
+			{
+				if (!collectROMs(argument, options.roms))
+				{
+					std::cerr << "could not read directory " << argument << "\n";
+					return false;
+				}
+
+				continue;
+			}
+
+			if (!hasValue)
+			{
+				std::cerr << "missing value for " << argument << "\n";
+				return false;
+			}
+
+			const char* value = argv[++i];
+			bool isValid = true;
+
+			if (argument == "--frames")
+			{
+				isValid = parseSize(value, options.frames);
+			}
+			else if (argument == "--cycles")
+			{
+				isValid = parseSize(value, options.cycles);
+			}
+			else if (argument == "--speed")
+			{
+				isValid = parseSize(value, options.speed) && options.speed > 0;
+			}
+			else if (argument == "--threads")
+			{
+				isValid = parseSize(value, options.threads);
+			}
+			else if (argument == "--rewind")
+			{
+				isValid = parseSize(value, options.rewind);
+			}
+			else if (argument == "--seed")
+			{
+				options.hasSeed = true;
+				isValid = parseSize(value, options.seed) && options.seed <= UINT32_MAX;
+			}
+			else if (argument == "--replay")
+			{
+				std::ifstream file(value, std::ios::binary);
+				options.hasReplay = true;
+				isValid = readMovie(file, options.replay);
+			}
+			else if (argument == "--dispatch")
+			{
+				isValid = parseDispatchMode(value, options.dispatchMode);
+			}
+			else if (argument == "--timing")
+			{
+				const std::string timing = value;
+				options.timingMode = timing == "fixed" ? TimingMode::FixedRate : TimingMode::Cycles;
+				options.waitForVBlank = timing == "vip-vblank";
+				isValid = timing == "fixed" || timing == "vip" || timing == "vip-vblank";
+			}
+			else if (argument == "--format")
+			{
+				options.format = value;
+				isValid = options.format == "json" || options.format == "csv";
+			}
+			else if (argument == "--output")
+			{
+				options.output = value;
+			}
+			else if (argument == "--load-states")
+			{
+				options.loadStates = value;
+				isValid = std::filesystem::is_directory(options.loadStates);
+			}
+			else if (argument == "--save-states")
+			{
+				std::error_code error;
+				options.saveStates = value;
+				std::filesystem::create_directories(options.saveStates, error);
+				isValid = std::filesystem::is_directory(options.saveStates, error);
+			}
+			else if (argument == "--profile")
+			{
+#ifdef QCHIP8_PROFILE
+				std::error_code error;
+				options.profiles = value;
+				std::filesystem::create_directories(options.profiles, error);
+				isValid = std::filesystem::is_directory(options.profiles, error);
+#else
+				std::cerr << "the profiler is not compiled in, configure with -DQCHIP8_ENABLE_PROFILER=ON\n";
+				return false;
+#endif
+			}
+			else if (argument == "--list")
+			{
+				std::ifstream list(value);
+				std::string line;
+
+				isValid = list.is_open();
+				while (isValid && std::getline(list, line))
+				{
+					if (!line.empty() && line.back() == '\r')
+					{
+						line.pop_back();
+					}
+
+					if (!line.empty() && line[0] != '#')
+					{
+						isValid = collectROMs(line, options.roms);
+					}
+				}
+			}
+			else
+			{
+				std::cerr << "unknown option " << argument << "\n";
+				return false;
+			}
+
+			if (!isValid)
+			{
+				std::cerr << "invalid value " << value << " for " << argument << "\n";
+				return false;
+			}
+		}
+
+		return true;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	Options options;
+	if (!parseOptions(argc, argv, options) || options.roms.empty())
+	{
+		std::cerr << "usage: qchip8-batch [--frames N | --cycles N] [--speed IPS] [--dispatch MODE] [--timing MODE] [--list FILE]\n"
+			"                    [--format json|csv] [--output FILE] [--threads N] [--rewind N]\n"
+			"                    [--seed N] [--replay FILE]\n"
+			"                    [--load-states DIR] [--save-states DIR] [--profile DIR] <roms or directories...>\n";
+		return 2;
+	}
+
+	// every ROM runs on its own CPU, results are written back by index so the report keeps the input order
+	std::vector<Result> results(options.roms.size());
+	{
+		ThreadPool pool(options.threads);
+		for (size_t i = 0; i < options.roms.size(); ++i)
+		{
+			pool.submit([&results, &options, i]()
+			{
+				results[i] = runROM(options.roms[i], i, options);
+			});
+		}
+
+		pool.wait();
+	}
+
+	std::ofstream file;
+	if (!options.output.empty())
+	{
+		file.open(options.output);
+		if (!file.is_open())
+		{
+			std::cerr << "could not open " << options.output << "\n";
+			return 1;
+		}
+	}
+
+	std::ostream& stream = options.output.empty() ? std::cout : file;
+	if (options.format == "csv")
+	{
+		writeCSV(stream, results);
+	}
+	else
+	{
+		writeJSON(stream, results);
+	}
+
+	const bool hasFailures = std::any_of(results.begin(), results.end(), isFailed);
+
+	return hasFailures ? 1 : 0;
+}
@@ -0,0 +1,86 @@
+#ifndef COMMANDLINE_H
+#define COMMANDLINE_H
+
+// Helpers shared by the headless tools and the benchmarks for parsing options and writing reports.
+
+#include <cctype>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <string>
+#include "is.h"
+
+namespace Chip8
+{
+    // parses a whole decimal argument, returns false if it has any other characters
+    inline bool parseSize(const char* text, size_t& value)
+    {
+        // strtoull() skips leading whitespace and negates a leading minus, so "-1" would become the largest value
+        if (!std::isdigit(static_cast<unsigned char>(text[0])))
+        {
+            return false;
+        }
+
+        char* end = nullptr;
+        const auto parsed = std::strtoull(text, &end, 10);
+        if (end == text || *end != '\0')
+        {
+            return false;
+        }
+
+        value = static_cast<size_t>(parsed);
+        return true;
+    }
+
+    // switch, table, threaded or block
+    inline bool parseDispatchMode(const std::string& name, DispatchMode& mode)
+    {
+        if (name == "switch")
+        {
+            mode = DispatchMode::Switch;
+        }
+        else if (name == "table")
+        {
+            mode = DispatchMode::Table;
+        }
+        else if (name == "threaded")
+        {
+            mode = DispatchMode::Threaded;
+        }
+        else if (name == "block")
+        {
+            mode = DispatchMode::Block;
+        }
+        else
+        {
+            return false;
+        }
+
+        return true;
+    }
+
+    // contents of a JSON string, without the surrounding quotes
+    inline std::string escapeJSON(const std::string& text)
+    {
+        std::ostringstream stream;
+        for (const char c : text)
+        {
+            if (c == '"' || c == '\\')
+            {
+                stream << '\\' << c;
+            }
+            else if (static_cast<unsigned char>(c) < 0x20)
+            {
+                stream << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c) << std::dec;
+            }
+            else
+            {
+                stream << c;
+            }
+        }
+
+        return stream.str();
+    }
+}
+
+#endif // COMMANDLINE_H